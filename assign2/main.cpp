@@ -4,6 +4,7 @@
 #include "testing/SimpleTest.h"
 #include "maze.h"
 #include "search.h"
+#include "searchserver.h"
 using namespace std;
 using namespace std::chrono;
 
@@ -28,6 +29,10 @@ int main()
 
     searchEngine("res/website.txt");
 
+    // Serve queries from stdin on a worker pool, or measure throughput
+    // searchServer("res/website.txt", 4);
+    // runLoadGenerator("res/website.txt", "res/querylog.txt", 8);
+
     cout << endl << "All done!" << endl;
     return 0;
 }
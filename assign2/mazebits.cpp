@@ -0,0 +1,683 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <utility>
+#include <vector>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "error.h"
+#include "filelib.h"
+#include "grid.h"
+#include "maze.h"
+#include "mazebits.h"
+#include "mazesearch.h"
+#include "random.h"
+#include "strlib.h"
+#include "testing/SimpleTest.h"
+using namespace std;
+
+MazeBits::MazeBits() : rows(0), cols(0), bits(nullptr) {
+}
+
+/*
+ * A maze of the given size where every cell is a wall
+ */
+MazeBits::MazeBits(int rows, int cols) : rows(rows), cols(cols) {
+    if (rows < 0 || cols < 0 || (long long) rows * cols > INT32_MAX) {
+        error("Maze dimensions out of range");
+    }
+    storage.assign(numBytes(), 0);
+    bits = storage.data();
+}
+
+/*
+ * Pack a Grid<bool> maze, true for corridor, into one bit per cell
+ */
+MazeBits::MazeBits(const Grid<bool>& maze) : MazeBits(maze.numRows(), maze.numCols()) {
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < cols; c++) {
+            if (maze.get(r, c)) {
+                setOpen(r, c, true);
+            }
+        }
+    }
+}
+
+/*
+ * Copy the cells of an owned maze, or share the mapping of a mapped one
+ */
+MazeBits::MazeBits(const MazeBits& other)
+    : rows(other.rows), cols(other.cols), mapping(other.mapping), bits(other.bits) {
+    if (!mapping) {
+        storage.assign(other.bits, other.bits + other.numBytes());
+        bits = storage.data();
+    }
+}
+
+MazeBits& MazeBits::operator=(const MazeBits& other) {
+    if (this != &other) {
+        rows = other.rows;
+        cols = other.cols;
+        mapping = other.mapping;
+        if (mapping) {
+            storage.clear();
+            bits = other.bits;
+        } else {
+            storage.assign(other.bits, other.bits + other.numBytes());
+            bits = storage.data();
+        }
+    }
+    return *this;
+}
+
+/*
+ * Take over the cells of <other>, which is left an empty maze. Moving a vector
+ * keeps its buffer, so <bits> stays valid for an owned maze as for a mapped one.
+ */
+MazeBits::MazeBits(MazeBits&& other)
+    : rows(other.rows), cols(other.cols), storage(std::move(other.storage)),
+      mapping(std::move(other.mapping)), bits(other.bits) {
+    other.rows = other.cols = 0;
+    other.storage.clear();
+    other.bits = nullptr;
+}
+
+MazeBits& MazeBits::operator=(MazeBits&& other) {
+    if (this != &other) {
+        rows = other.rows;
+        cols = other.cols;
+        storage = std::move(other.storage);
+        mapping = std::move(other.mapping);
+        bits = other.bits;
+        other.rows = other.cols = 0;
+        other.storage.clear();
+        other.bits = nullptr;
+    }
+    return *this;
+}
+
+void MazeBits::setOpen(int row, int col, bool open) {
+    if (!inBounds(row, col)) {
+        error("Maze location out of bounds");
+    }
+    if (mapping) {
+        // the mapping is read-only, take a private copy before the first write
+        storage.assign(bits, bits + numBytes());
+        bits = storage.data();
+        mapping.reset();
+    }
+    int cell = cellOf(row, col);
+    if (open) {
+        storage[cell >> 3] |= 1 << (cell & 7);
+    } else {
+        storage[cell >> 3] &= ~(1 << (cell & 7));
+    }
+}
+
+/*
+ * Unpack into a Grid<bool>, for the functions in maze.cpp
+ */
+Grid<bool> MazeBits::toGrid() const {
+    Grid<bool> maze(rows, cols, false);
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < cols; c++) {
+            maze[r][c] = isOpen(cellOf(r, c));
+        }
+    }
+    return maze;
+}
+
+/*
+ * Generate a random maze with entry (0, 0) and exit (rows-1, cols-1).
+ *
+ * Rooms sit at even coordinates and are carved into a spanning tree by an
+ * iterative randomized depth-first search, which gives a perfect maze (exactly
+ * one path between any two rooms). Afterwards every remaining wall between two
+ * rooms is knocked down with probability <openFraction>, adding loops, so 1
+ * leaves only the pillars at odd coordinates. An even number of rows or columns
+ * has no rooms along the last row or column, so that line is left fully open.
+ */
+MazeBits generateMaze(int rows, int cols, double openFraction) {
+    if (rows < 1 || cols < 1) {
+        error("Maze must have at least one row and one column");
+    }
+    MazeBits maze(rows, cols);
+    const int steps[4][2] = {{-2, 0}, {2, 0}, {0, -2}, {0, 2}};
+
+    // a room is visited once it is open, so the maze doubles as the visited set
+    vector<int> stack;
+    stack.push_back(0);
+    maze.setOpen(0, 0, true);
+    while (!stack.empty()) {
+        GridLocation cur = maze.locationOf(stack.back());
+        int choices[4];
+        int numChoices = 0;
+        for (int i = 0; i < 4; i++) {
+            int r = cur.row + steps[i][0];
+            int c = cur.col + steps[i][1];
+            if (maze.inBounds(r, c) && !maze.isOpen(r, c)) {
+                choices[numChoices++] = i;
+            }
+        }
+        if (numChoices == 0) {
+            stack.pop_back();
+            continue;
+        }
+        int step = choices[randomInteger(0, numChoices - 1)];
+        int r = cur.row + steps[step][0];
+        int c = cur.col + steps[step][1];
+        maze.setOpen(cur.row + steps[step][0] / 2, cur.col + steps[step][1] / 2, true);
+        maze.setOpen(r, c, true);
+        stack.push_back(maze.cellOf(r, c));
+    }
+
+    if (openFraction > 0) {
+        for (int r = 0; r < rows; r++) {
+            // walls between rooms have exactly one odd coordinate
+            for (int c = (r % 2 == 0) ? 1 : 0; c < cols; c += 2) {
+                if (!maze.isOpen(r, c) && randomChance(openFraction)) {
+                    maze.setOpen(r, c, true);
+                }
+            }
+        }
+    }
+
+    if (rows % 2 == 0) {
+        for (int c = 0; c < cols; c++) {
+            maze.setOpen(rows - 1, c, true);
+        }
+    }
+    if (cols % 2 == 0) {
+        for (int r = 0; r < rows; r++) {
+            maze.setOpen(r, cols - 1, true);
+        }
+    }
+    return maze;
+}
+
+/* * * * * * Maze files * * * * * */
+
+/*
+ * Read-only memory mapping of a whole file, unmapped when destroyed
+ */
+class MappedFile {
+public:
+    MappedFile(const string& filename);
+    ~MappedFile();
+
+    const uint8_t* data() const { return base; }
+    size_t size() const { return length; }
+
+private:
+    const uint8_t* base;
+    size_t length;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE view;
+#endif
+};
+
+#ifdef _WIN32
+MappedFile::MappedFile(const string& filename) : base(nullptr), length(0), view(nullptr) {
+    file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    // error() throws, so the destructor will not run: close what is open first
+    LARGE_INTEGER size;
+    if (file == INVALID_HANDLE_VALUE) {
+        error("Cannot open file named " + filename);
+    }
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        error("Cannot open file named " + filename);
+    }
+    length = size.QuadPart;
+    if (length > 0) {
+        view = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        base = view ? (const uint8_t*) MapViewOfFile(view, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (base == nullptr) {
+            if (view != nullptr) CloseHandle(view);
+            CloseHandle(file);
+            error("Cannot map file named " + filename);
+        }
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (base != nullptr) UnmapViewOfFile(base);
+    if (view != nullptr) CloseHandle(view);
+    CloseHandle(file);
+}
+#else
+MappedFile::MappedFile(const string& filename) : base(nullptr), length(0) {
+    // error() throws, so the destructor will not run: close what is open first
+    int fd = open(filename.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0) {
+        error("Cannot open file named " + filename);
+    }
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        error("Cannot open file named " + filename);
+    }
+    length = info.st_size;
+    if (length > 0) {
+        void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            close(fd);
+            error("Cannot map file named " + filename);
+        }
+        base = (const uint8_t*) address;
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (base != nullptr) {
+        munmap((void*) base, length);
+    }
+}
+#endif
+
+/*
+ * Binary maze files start with a 16-byte header, all integers little-endian:
+ *   bytes 0-3    magic "MZB1"
+ *   bytes 4-7    number of rows
+ *   bytes 8-11   number of columns
+ *   byte 12      encoding, kRawEncoding or kRunEncoding
+ *   bytes 13-15  zero
+ * A raw body is the MazeBits cell bits exactly as held in memory, so it can be
+ * used straight from the mapped file. A run-length body is the lengths of the
+ * alternating runs of walls and corridors in row-major order, starting with
+ * walls (possibly an empty run), each written as a varint of 7 bits per byte.
+ */
+const char kMagic[4] = {'M', 'Z', 'B', '1'};
+const int kHeaderSize = 16;
+const uint8_t kRawEncoding = 0;
+const uint8_t kRunEncoding = 1;
+
+static void writeUint32(string& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out += (char) (value >> (8 * i));
+    }
+}
+
+static uint32_t readUint32(const uint8_t* in) {
+    return in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t) in[3] << 24);
+}
+
+/*
+ * Append <value> to <out> using 7 bits per byte, high bit set on all but the last byte
+ */
+static void writeVarint(string& out, uint32_t value) {
+    while (value >= 0x80) {
+        out += (char) ((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += (char) value;
+}
+
+/*
+ * Read a varint from <in> starting at <pos> and advance <pos> past it. A value
+ * cut off by the end of the file is an error rather than a read past the mapping.
+ */
+static uint32_t readVarint(const uint8_t* in, size_t& pos, size_t size) {
+    uint32_t value = 0;
+    int shift = 0;
+    uint8_t byte;
+    do {
+        if (pos >= size || shift > 28) {
+            error("Binary maze file has a malformed run length");
+        }
+        byte = in[pos++];
+        value |= (uint32_t) (byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+/*
+ * Open the run of corridor cells [first, last) in <bits>, whole bytes at a time
+ */
+static void openRange(vector<uint8_t>& bits, uint32_t first, uint32_t last) {
+    while (first < last && (first & 7) != 0) {
+        bits[first >> 3] |= 1 << (first & 7);
+        first++;
+    }
+    while (first + 8 <= last) {
+        bits[first >> 3] = 0xff;
+        first += 8;
+    }
+    while (first < last) {
+        bits[first >> 3] |= 1 << (first & 7);
+        first++;
+    }
+}
+
+/*
+ * Read a maze from the text format of readMazeFile ('@' wall, '-' corridor)
+ * straight into bits, one line at a time
+ */
+MazeBits readMazeText(string filename) {
+    ifstream in;
+    if (!openFile(in, filename)) {
+        error("Cannot open file named " + filename);
+    }
+
+    // the number of rows is unknown until the end, so pack into a growing buffer
+    vector<uint8_t> packed;
+    string line;
+    int rows = 0;
+    int cols = -1;
+    uint32_t cell = 0;
+    while (getline(in, line)) {
+        if (!line.empty() && line[line.size() - 1] == '\r') {
+            line.resize(line.size() - 1);
+        }
+        if (cols < 0) {
+            cols = line.size();
+        } else if ((int) line.size() != cols) {
+            error("Maze row has inconsistent number of columns");
+        }
+        packed.resize(((size_t) (rows + 1) * cols + 7) / 8, 0);
+        for (char ch : line) {
+            if (ch == '-') {
+                packed[cell >> 3] |= 1 << (cell & 7);
+            } else if (ch != '@') {
+                error("Maze location has invalid character: '" + charToString(ch) + "'");
+            }
+            cell++;
+        }
+        rows++;
+    }
+    if (rows == 0) {
+        error("Maze file " + filename + " is empty");
+    }
+
+    MazeBits maze(rows, cols);
+    maze.storage.swap(packed);
+    maze.bits = maze.storage.data();
+    return maze;
+}
+
+/*
+ * Write a maze in the text format of readMazeFile
+ */
+void writeMazeText(const MazeBits& maze, string filename) {
+    ofstream out(filename, ios::binary);
+    if (!out) {
+        error("Cannot open file named " + filename);
+    }
+    string line(maze.numCols() + 1, '\n');
+    for (int r = 0; r < maze.numRows(); r++) {
+        for (int c = 0; c < maze.numCols(); c++) {
+            line[c] = maze.isOpen(maze.cellOf(r, c)) ? '-' : '@';
+        }
+        // the last line has no newline, like the files in res
+        out.write(line.data(), r == maze.numRows() - 1 ? maze.numCols() : line.size());
+    }
+}
+
+/*
+ * Write a maze in the binary format, raw or run-length encoded
+ */
+void writeMazeBinary(const MazeBits& maze, string filename, bool compress) {
+    string header(kMagic, 4);
+    writeUint32(header, maze.numRows());
+    writeUint32(header, maze.numCols());
+    header += (char) (compress ? kRunEncoding : kRawEncoding);
+    header.append(3, '\0');
+
+    ofstream out(filename, ios::binary);
+    if (!out) {
+        error("Cannot open file named " + filename);
+    }
+    out.write(header.data(), header.size());
+    if (!compress) {
+        out.write((const char*) maze.data(), maze.numBytes());
+    } else {
+        string body;
+        bool open = false;
+        uint32_t run = 0;
+        for (int cell = 0; cell < maze.numCells(); cell++) {
+            if (maze.isOpen(cell) != open) {
+                writeVarint(body, run);
+                open = !open;
+                run = 0;
+            }
+            run++;
+        }
+        writeVarint(body, run);
+        out.write(body.data(), body.size());
+    }
+    if (!out) {
+        error("Cannot write file named " + filename);
+    }
+}
+
+/*
+ * Load a binary maze file. A raw file is memory-mapped and the maze's bits
+ * point into the mapping, so loading costs no copying or parsing at all. A
+ * run-length file is decoded into an owned maze.
+ */
+MazeBits readMazeBinary(string filename) {
+    shared_ptr<const MappedFile> file = make_shared<MappedFile>(filename);
+    const uint8_t* base = file->data();
+    if (file->size() < (size_t) kHeaderSize || memcmp(base, kMagic, 4) != 0) {
+        error(filename + " is not a binary maze file");
+    }
+    uint32_t rows = readUint32(base + 4);
+    uint32_t cols = readUint32(base + 8);
+    uint8_t encoding = base[12];
+    if ((uint64_t) rows * cols > INT32_MAX) {
+        error(filename + " has maze dimensions out of range");
+    }
+
+    MazeBits maze;
+    maze.rows = rows;
+    maze.cols = cols;
+    if (encoding == kRawEncoding) {
+        if (file->size() < (size_t) kHeaderSize + maze.numBytes()) {
+            error(filename + " is truncated");
+        }
+        maze.mapping = file;
+        maze.bits = base + kHeaderSize;
+    } else if (encoding == kRunEncoding) {
+        maze.storage.assign(maze.numBytes(), 0);
+        maze.bits = maze.storage.data();
+        size_t pos = kHeaderSize;
+        uint32_t cell = 0;
+        bool open = false;
+        while (cell < (uint32_t) maze.numCells()) {
+            if (pos >= file->size()) {
+                error(filename + " is truncated");
+            }
+            uint32_t run = readVarint(base, pos, file->size());
+            if (run > maze.numCells() - cell) {
+                error(filename + " has runs past the last cell");
+            }
+            if (open) {
+                openRange(maze.storage, cell, cell + run);
+            }
+            cell += run;
+            open = !open;
+        }
+    } else {
+        error(filename + " has unknown encoding");
+    }
+    return maze;
+}
+
+void convertMazeTextToBinary(string textFile, string binaryFile, bool compress) {
+    writeMazeBinary(readMazeText(textFile), binaryFile, compress);
+}
+
+void convertMazeBinaryToText(string binaryFile, string textFile) {
+    writeMazeText(readMazeBinary(binaryFile), textFile);
+}
+
+
+/* * * * * * Test Cases * * * * * */
+
+STUDENT_TEST("MazeBits round trip from and to Grid<bool>") {
+    Grid<bool> maze = {{true, false, true},
+                       {true, true, false}};
+    MazeBits bits(maze);
+    EXPECT_EQUAL(bits.numRows(), 2);
+    EXPECT_EQUAL(bits.numCols(), 3);
+    EXPECT(bits.isOpen(1, 1));
+    EXPECT(!bits.isOpen(0, 1));
+    EXPECT(!bits.isOpen(-1, 0));
+    EXPECT(!bits.isOpen(0, 3));
+    EXPECT_EQUAL(bits.locationOf(bits.cellOf(1, 2)), GridLocation(1, 2));
+    EXPECT_EQUAL(bits.toGrid(), maze);
+
+    MazeBits copy = bits;
+    copy.setOpen(0, 1, true);
+    EXPECT(copy.isOpen(0, 1));
+    EXPECT(!bits.isOpen(0, 1));
+
+    // moves take the bit array over instead of copying it
+    const uint8_t* cells = copy.data();
+    MazeBits moved = std::move(copy);
+    EXPECT_EQUAL(moved.data(), cells);
+    EXPECT(moved.isOpen(0, 1));
+    EXPECT_EQUAL(copy.numCells(), 0);
+    bits = std::move(moved);
+    EXPECT_EQUAL(bits.data(), cells);
+    EXPECT_EQUAL(bits.toGrid().get(0, 1), true);
+}
+
+STUDENT_TEST("generateMaze opens entry, exit and only pillars when fully open") {
+    for (int size = 1; size <= 8; size++) {
+        MazeBits maze = generateMaze(size, size + 3);
+        EXPECT(maze.isOpen(0, 0));
+        EXPECT(maze.isOpen(size - 1, size + 2));
+    }
+    MazeBits open = generateMaze(5, 5, 1);
+    for (int r = 0; r < 5; r++) {
+        for (int c = 0; c < 5; c++) {
+            EXPECT_EQUAL(open.isOpen(r, c), r % 2 == 0 || c % 2 == 0);
+        }
+    }
+}
+
+/* Test helper for the size of a file in bytes */
+static long long fileSize(string filename) {
+    ifstream in(filename, ios::binary | ios::ate);
+    return in.tellg();
+}
+
+STUDENT_TEST("Text and binary maze files round trip to the same maze as readMazeFile") {
+    string binary = getTempDirectory() + "/roundtrip.mzb";
+    string text = getTempDirectory() + "/roundtrip.maze";
+    for (const string& name : listDirectory("res")) {
+        if (!endsWith(name, ".maze")) continue;
+        Grid<bool> expected;
+        readMazeFile("res/" + name, expected);
+        EXPECT_EQUAL(readMazeText("res/" + name).toGrid(), expected);
+
+        for (bool compress : {false, true}) {
+            convertMazeTextToBinary("res/" + name, binary, compress);
+            MazeBits loaded = readMazeBinary(binary);
+            EXPECT_EQUAL(loaded.isMapped(), !compress);
+            EXPECT_EQUAL(loaded.toGrid(), expected);
+
+            convertMazeBinaryToText(binary, text);
+            Grid<bool> back;
+            readMazeFile(text, back);
+            EXPECT_EQUAL(back, expected);
+        }
+    }
+    deleteFile(binary);
+    deleteFile(text);
+}
+
+STUDENT_TEST("Run-length files handle mazes starting open and runs across bytes") {
+    string binary = getTempDirectory() + "/runs.mzb";
+    for (int trial = 0; trial < 20; trial++) {
+        MazeBits maze = generateMaze(randomInteger(1, 40), randomInteger(1, 40), randomReal(0, 1));
+        writeMazeBinary(maze, binary, true);
+        EXPECT_EQUAL(readMazeBinary(binary).toGrid(), maze.toGrid());
+    }
+    MazeBits walls(3, 11);
+    writeMazeBinary(walls, binary, true);
+    EXPECT_EQUAL(readMazeBinary(binary).toGrid(), walls.toGrid());
+    deleteFile(binary);
+}
+
+STUDENT_TEST("Mapped maze is solvable in place and copies on write") {
+    string binary = getTempDirectory() + "/mapped.mzb";
+    MazeBits original = generateMaze(51, 71);
+    writeMazeBinary(original, binary);
+
+    MazeBits mapped = readMazeBinary(binary);
+    EXPECT(mapped.isMapped());
+    GridLocation exit(50, 70);
+    EXPECT_EQUAL(bfsShortestPath(mapped, {0, 0}, exit).size(),
+                 bfsShortestPath(original, {0, 0}, exit).size());
+
+    MazeBits copy = mapped;
+    EXPECT(copy.isMapped());
+    EXPECT_EQUAL(copy.data(), mapped.data());
+    copy.setOpen(1, 1, !copy.isOpen(1, 1));
+    EXPECT(!copy.isMapped());
+    EXPECT(mapped.isMapped());
+    EXPECT(copy.isOpen(1, 1) != mapped.isOpen(1, 1));
+    EXPECT_EQUAL(readMazeBinary(binary).toGrid(), original.toGrid());
+    deleteFile(binary);
+}
+
+STUDENT_TEST("Binary maze files reject bad input") {
+    string binary = getTempDirectory() + "/bad.mzb";
+    EXPECT_ERROR(readMazeBinary("res/13x39.maze"));
+    writeMazeBinary(generateMaze(9, 9), binary);
+    string bytes;
+    {
+        ifstream in(binary, ios::binary);
+        bytes.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+    {
+        ofstream out(binary, ios::binary);
+        out.write(bytes.data(), bytes.size() - 1);
+    }
+    EXPECT_ERROR(readMazeBinary(binary));
+    EXPECT_ERROR(readMazeBinary(getTempDirectory() + "/missing.mzb"));
+    deleteFile(binary);
+}
+
+STUDENT_TEST("Time loading text and binary maze files, with file sizes") {
+    string text = getTempDirectory() + "/bench.maze";
+    string raw = getTempDirectory() + "/bench.mzb";
+    string runs = getTempDirectory() + "/bench-rle.mzb";
+
+    for (int size : {1001, 20001}) {
+        MazeBits maze = generateMaze(size, size);
+        writeMazeText(maze, text);
+        writeMazeBinary(maze, raw);
+        writeMazeBinary(maze, runs, true);
+        cout << size << "x" << size << ": text " << fileSize(text) << " bytes, raw "
+             << fileSize(raw) << " bytes, run-length " << fileSize(runs) << " bytes" << endl;
+
+        Grid<bool> grid;
+        if (size <= 1001) {
+            TIME_OPERATION(size, readMazeFile(text, grid));
+        }
+        TIME_OPERATION(size, readMazeText(text));
+        TIME_OPERATION(size, readMazeBinary(raw));
+        TIME_OPERATION(size, readMazeBinary(runs));
+        if (size <= 1001) {
+            // a search touches every page, paying the cost the mapping deferred
+            TIME_OPERATION(size, bfsShortestPath(readMazeBinary(raw), {0, 0}, {size - 1, size - 1}));
+        }
+    }
+    deleteFile(text);
+    deleteFile(raw);
+    deleteFile(runs);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "grid.h"
+#include "gridlocation.h"
+
+class MappedFile;
+
+/*
+ * Maze stored as one bit per cell in row-major order, bit set for a corridor.
+ * Cell (row, col) has the flat index row * numCols() + col, so a solver can
+ * walk the maze with integer arithmetic instead of GridLocation objects.
+ *
+ * The bits are either owned by the maze or, for a maze loaded with
+ * readMazeBinary, a read-only view of the memory-mapped file. Copies of a
+ * mapped maze share the mapping; setOpen makes a private copy first.
+ */
+class MazeBits {
+public:
+    MazeBits();
+    MazeBits(int rows, int cols);
+    MazeBits(const Grid<bool>& maze);
+    MazeBits(const MazeBits& other);
+    MazeBits& operator=(const MazeBits& other);
+    MazeBits(MazeBits&& other);
+    MazeBits& operator=(MazeBits&& other);
+
+    int numRows() const { return rows; }
+    int numCols() const { return cols; }
+    int numCells() const { return rows * cols; }
+
+    int cellOf(int row, int col) const { return row * cols + col; }
+    int cellOf(GridLocation loc) const { return loc.row * cols + loc.col; }
+    GridLocation locationOf(int cell) const { return GridLocation(cell / cols, cell % cols); }
+
+    bool inBounds(int row, int col) const { return row >= 0 && row < rows && col >= 0 && col < cols; }
+    bool isOpen(int cell) const { return (bits[cell >> 3] >> (cell & 7)) & 1; }
+    bool isOpen(int row, int col) const { return inBounds(row, col) && isOpen(cellOf(row, col)); }
+    void setOpen(int row, int col, bool open);
+
+    const uint8_t* data() const { return bits; }
+    int numBytes() const { return (numCells() + 7) / 8; }
+    bool isMapped() const { return mapping != nullptr; }
+    Grid<bool> toGrid() const;
+
+private:
+    friend MazeBits readMazeText(std::string filename);
+    friend MazeBits readMazeBinary(std::string filename);
+
+    int rows;
+    int cols;
+    std::vector<uint8_t> storage;
+    std::shared_ptr<const MappedFile> mapping;
+    const uint8_t* bits;        // storage.data() for an owned maze, else inside the mapping
+};
+
+MazeBits generateMaze(int rows, int cols, double openFraction = 0);
+
+MazeBits readMazeText(std::string filename);
+
+void writeMazeText(const MazeBits& maze, std::string filename);
+
+MazeBits readMazeBinary(std::string filename);
+
+void writeMazeBinary(const MazeBits& maze, std::string filename, bool compress = false);
+
+void convertMazeTextToBinary(std::string textFile, std::string binaryFile, bool compress = false);
+
+void convertMazeBinaryToText(std::string binaryFile, std::string textFile);
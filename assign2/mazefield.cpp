@@ -0,0 +1,402 @@
+#include <iostream>
+#include <algorithm>
+#include "error.h"
+#include "maze.h"
+#include "mazebits.h"
+#include "mazefield.h"
+#include "mazesearch.h"
+#include "random.h"
+#include "vector.h"
+#include "testing/SimpleTest.h"
+using namespace std;
+
+/* * * * * * DistanceField * * * * * */
+
+DistanceField::DistanceField(const MazeBits& maze, GridLocation source) {
+    build(maze, {source});
+}
+
+DistanceField::DistanceField(const MazeBits& maze, const Vector<GridLocation>& sources) {
+    build(maze, sources);
+}
+
+/*
+ * Breadth-first search seeded with every source at distance 0, so each cell is
+ * reached first from its nearest source. Sources on walls are ignored.
+ */
+void DistanceField::build(const MazeBits& maze, const Vector<GridLocation>& sources) {
+    rows = maze.numRows();
+    cols = maze.numCols();
+    dist.assign(maze.numCells(), -1);
+    CellQueue queue(2 * (rows + cols));
+
+    for (const GridLocation& source : sources) {
+        if (maze.isOpen(source.row, source.col) && dist[maze.cellOf(source)] < 0) {
+            dist[maze.cellOf(source)] = 0;
+            queue.enqueue(maze.cellOf(source));
+        }
+    }
+    while (!queue.isEmpty()) {
+        int cur = queue.dequeue();
+        int col = cur % cols;
+        int next = dist[cur] + 1;
+        if (cur >= cols && dist[cur - cols] < 0 && maze.isOpen(cur - cols)) {
+            dist[cur - cols] = next;
+            queue.enqueue(cur - cols);
+        }
+        if (cur + cols < maze.numCells() && dist[cur + cols] < 0 && maze.isOpen(cur + cols)) {
+            dist[cur + cols] = next;
+            queue.enqueue(cur + cols);
+        }
+        if (col > 0 && dist[cur - 1] < 0 && maze.isOpen(cur - 1)) {
+            dist[cur - 1] = next;
+            queue.enqueue(cur - 1);
+        }
+        if (col < cols - 1 && dist[cur + 1] < 0 && maze.isOpen(cur + 1)) {
+            dist[cur + 1] = next;
+            queue.enqueue(cur + 1);
+        }
+    }
+}
+
+/*
+ * @return The number of steps from the nearest source to <goal>, or -1 if
+ *         <goal> is out of bounds, a wall, or unreachable
+ */
+int DistanceField::distance(GridLocation goal) const {
+    if (goal.row < 0 || goal.row >= rows || goal.col < 0 || goal.col >= cols) {
+        return -1;
+    }
+    return dist[goal.row * cols + goal.col];
+}
+
+/*
+ * Walk downhill from <goal> to a source, one neighbor closer per step
+ * @return The locations from <goal> to its nearest source, or an empty Vector
+ *         if <goal> cannot be reached
+ */
+Vector<GridLocation> DistanceField::pathFrom(GridLocation goal) const {
+    Vector<GridLocation> path;
+    int d = distance(goal);
+    if (d < 0) {
+        return path;
+    }
+    int cell = goal.row * cols + goal.col;
+    path.add(goal);
+    for (; d > 0; d--) {
+        // walls and unreached cells hold -1, so a match is always open
+        int col = cell % cols;
+        if (cell >= cols && dist[cell - cols] == d - 1) {
+            cell -= cols;
+        } else if (cell + cols < (int) dist.size() && dist[cell + cols] == d - 1) {
+            cell += cols;
+        } else if (col > 0 && dist[cell - 1] == d - 1) {
+            cell -= 1;
+        } else {
+            cell += 1;
+        }
+        path.add(GridLocation(cell / cols, cell % cols));
+    }
+    return path;
+}
+
+/*
+ * @return The locations of a shortest path from the nearest source to <goal>,
+ *         or an empty Vector if <goal> cannot be reached
+ */
+Vector<GridLocation> DistanceField::pathTo(GridLocation goal) const {
+    Vector<GridLocation> path = pathFrom(goal);
+    path.reverse();
+    return path;
+}
+
+long long DistanceField::memoryUsage() const {
+    return sizeof(*this) + dist.capacity() * sizeof(int);
+}
+
+
+/* * * * * * DistanceFieldCache * * * * * */
+
+DistanceFieldCache::DistanceFieldCache(const MazeBits& maze, int capacity)
+    : maze(maze), capacity(capacity), numHits(0), numMisses(0) {
+    if (capacity < 1) {
+        error("DistanceFieldCache capacity must be positive");
+    }
+}
+
+/*
+ * @return The cached field whose source is <cell>, marked most recently used,
+ *         or null if there is none
+ */
+shared_ptr<const DistanceField> DistanceFieldCache::cached(int cell) {
+    auto found = lookupTable.find(cell);
+    if (found == lookupTable.end()) {
+        return nullptr;
+    }
+    entries.splice(entries.begin(), entries, found->second);
+    return found->second->second;
+}
+
+/*
+ * @return The distance field of <source>, built and cached if not already
+ *         present, evicting the least recently used field when full
+ */
+shared_ptr<const DistanceField> DistanceFieldCache::field(GridLocation source) {
+    if (!maze.inBounds(source.row, source.col)) {
+        error("Maze location out of bounds");
+    }
+    int cell = maze.cellOf(source);
+    shared_ptr<const DistanceField> found = cached(cell);
+    if (found) {
+        numHits++;
+        return found;
+    }
+    numMisses++;
+    if ((int) entries.size() >= capacity) {
+        lookupTable.erase(entries.back().first);
+        entries.pop_back();
+    }
+    entries.emplace_front(cell, make_shared<DistanceField>(maze, source));
+    lookupTable[cell] = entries.begin();
+    return entries.front().second;
+}
+
+/*
+ * Find a shortest path, reusing the field of <goal> walked the other way if
+ * that one is cached and <start> is not
+ *
+ * @return The locations of the path from start to goal, or an empty Vector if
+ *         goal cannot be reached
+ */
+Vector<GridLocation> DistanceFieldCache::shortestPath(GridLocation start, GridLocation goal) {
+    if (maze.inBounds(goal.row, goal.col) && !lookupTable.count(maze.cellOf(start))) {
+        shared_ptr<const DistanceField> reverse = cached(maze.cellOf(goal));
+        if (reverse) {
+            numHits++;
+            return reverse->pathFrom(start);
+        }
+    }
+    return field(start)->pathTo(goal);
+}
+
+/*
+ * @return The number of steps on a shortest path from start to goal, or -1 if
+ *         goal cannot be reached
+ */
+int DistanceFieldCache::distance(GridLocation start, GridLocation goal) {
+    if (maze.inBounds(goal.row, goal.col) && !lookupTable.count(maze.cellOf(start))) {
+        shared_ptr<const DistanceField> reverse = cached(maze.cellOf(goal));
+        if (reverse) {
+            numHits++;
+            return reverse->distance(start);
+        }
+    }
+    return field(start)->distance(goal);
+}
+
+
+/* * * * * * Batches * * * * * */
+
+/*
+ * Answer a batch of queries with one distance field per distinct endpoint.
+ * Queries are grouped by start, or by goal if there are fewer distinct goals
+ * (walking those fields the other way), and each group's field is built once
+ * and dropped before the next, so at most one field is held at a time.
+ *
+ * @return The shortest path for each query, in the same order as <queries>
+ */
+Vector<Vector<GridLocation>> solveQueries(const MazeBits& maze, const Vector<MazeQuery>& queries) {
+    vector<int> starts, goals;
+    for (const MazeQuery& query : queries) {
+        if (!maze.inBounds(query.start.row, query.start.col) || !maze.inBounds(query.goal.row, query.goal.col)) {
+            error("Maze location out of bounds");
+        }
+        starts.push_back(maze.cellOf(query.start));
+        goals.push_back(maze.cellOf(query.goal));
+    }
+    auto countDistinct = [](vector<int> cells) {
+        sort(cells.begin(), cells.end());
+        return unique(cells.begin(), cells.end()) - cells.begin();
+    };
+    bool byGoal = countDistinct(goals) < countDistinct(starts);
+    const vector<int>& keys = byGoal ? goals : starts;
+
+    vector<int> order(queries.size());
+    for (int i = 0; i < (int) order.size(); i++) {
+        order[i] = i;
+    }
+    sort(order.begin(), order.end(), [&keys](int a, int b) { return keys[a] < keys[b]; });
+
+    Vector<Vector<GridLocation>> paths(queries.size());
+    for (int first = 0; first < (int) order.size(); ) {
+        int key = keys[order[first]];
+        DistanceField field(maze, maze.locationOf(key));
+        int i = first;
+        for (; i < (int) order.size() && keys[order[i]] == key; i++) {
+            const MazeQuery& query = queries[order[i]];
+            paths[order[i]] = byGoal ? field.pathFrom(query.start) : field.pathTo(query.goal);
+        }
+        first = i;
+    }
+    return paths;
+}
+
+
+/* * * * * * Test Cases * * * * * */
+
+/* Test helper for a random open cell */
+static GridLocation randomOpenCell(const MazeBits& maze) {
+    while (true) {
+        GridLocation loc(randomInteger(0, maze.numRows() - 1), randomInteger(0, maze.numCols() - 1));
+        if (maze.isOpen(loc.row, loc.col)) {
+            return loc;
+        }
+    }
+}
+
+/* Test helper for <count> random queries whose starts come from <numSources> cells */
+static Vector<MazeQuery> randomQueries(const MazeBits& maze, int count, int numSources) {
+    Vector<GridLocation> sources;
+    for (int i = 0; i < numSources; i++) {
+        sources.add(randomOpenCell(maze));
+    }
+    Vector<MazeQuery> queries;
+    for (int i = 0; i < count; i++) {
+        queries.add({sources[randomInteger(0, numSources - 1)], randomOpenCell(maze)});
+    }
+    return queries;
+}
+
+/* Test helpers to answer every query one way or another */
+static long long answerWithBFS(const MazeBits& maze, const Vector<MazeQuery>& queries) {
+    long long steps = 0;
+    for (const MazeQuery& query : queries) {
+        steps += bfsShortestPath(maze, query.start, query.goal).size();
+    }
+    return steps;
+}
+
+static long long answerWithCache(const MazeBits& maze, const Vector<MazeQuery>& queries, int capacity) {
+    DistanceFieldCache cache(maze, capacity);
+    long long steps = 0;
+    for (const MazeQuery& query : queries) {
+        steps += cache.shortestPath(query.start, query.goal).size();
+    }
+    return steps;
+}
+
+static long long answerInBatch(const MazeBits& maze, const Vector<MazeQuery>& queries) {
+    long long steps = 0;
+    for (const Vector<GridLocation>& path : solveQueries(maze, queries)) {
+        steps += path.size();
+    }
+    return steps;
+}
+
+STUDENT_TEST("DistanceField paths are valid and as short as breadth-first search") {
+    PathValidator validator;
+    for (int trial = 0; trial < 200; trial++) {
+        MazeBits maze = generateMaze(randomInteger(1, 30), randomInteger(1, 30), randomReal(0, 1));
+        GridLocation start = randomOpenCell(maze);
+        GridLocation goal = randomOpenCell(maze);
+        DistanceField field(maze, start);
+        Vector<GridLocation> expected = bfsShortestPath(maze, start, goal);
+
+        Vector<GridLocation> path = field.pathTo(goal);
+        EXPECT_EQUAL(path.size(), expected.size());
+        EXPECT_EQUAL(field.distance(goal), expected.size() - 1);
+        EXPECT(validator.check(maze, &path[0], path.size(), start, goal) == nullptr);
+
+        Vector<GridLocation> back = field.pathFrom(goal);
+        EXPECT(validator.check(maze, &back[0], back.size(), goal, start) == nullptr);
+    }
+}
+
+STUDENT_TEST("DistanceField reports walls and unreachable cells") {
+    Grid<bool> grid = {{true, false, true},
+                       {true, false, true}};
+    MazeBits maze(grid);
+    DistanceField field(maze, {0, 0});
+    EXPECT_EQUAL(field.distance({1, 0}), 1);
+    EXPECT_EQUAL(field.distance({0, 1}), -1);
+    EXPECT_EQUAL(field.distance({1, 2}), -1);
+    EXPECT_EQUAL(field.distance({5, 5}), -1);
+    EXPECT(field.pathTo({1, 2}).isEmpty());
+    EXPECT_EQUAL(field.pathTo({0, 0}), Vector<GridLocation>({{0, 0}}));
+}
+
+STUDENT_TEST("Multi-source DistanceField measures the distance to the nearest source") {
+    for (int trial = 0; trial < 50; trial++) {
+        MazeBits maze = generateMaze(randomInteger(3, 25), randomInteger(3, 25), randomReal(0, 1));
+        Vector<GridLocation> sources;
+        for (int i = randomInteger(1, 5); i > 0; i--) {
+            sources.add(randomOpenCell(maze));
+        }
+        DistanceField nearest(maze, sources);
+        GridLocation goal = randomOpenCell(maze);
+
+        int expected = INT32_MAX;
+        for (const GridLocation& source : sources) {
+            expected = min(expected, DistanceField(maze, source).distance(goal));
+        }
+        EXPECT_EQUAL(nearest.distance(goal), expected);
+        Vector<GridLocation> path = nearest.pathTo(goal);
+        EXPECT_EQUAL(path.size(), expected + 1);
+        bool startsAtSource = false;
+        for (const GridLocation& source : sources) {
+            startsAtSource = startsAtSource || source == path[0];
+        }
+        EXPECT(startsAtSource);
+    }
+}
+
+STUDENT_TEST("DistanceFieldCache reuses fields from either end and evicts the oldest") {
+    MazeBits maze = generateMaze(41, 41, 0.3);
+    DistanceFieldCache cache(maze, 2);
+    GridLocation a(0, 0), b(40, 40), c(20, 20);
+
+    EXPECT_EQUAL(cache.distance(a, b), bfsShortestPath(maze, a, b).size() - 1);
+    EXPECT_EQUAL(cache.misses(), 1);
+    EXPECT_EQUAL(cache.shortestPath(b, a).size(), bfsShortestPath(maze, b, a).size());
+    EXPECT_EQUAL(cache.misses(), 1);
+    EXPECT_EQUAL(cache.size(), 1);
+
+    cache.field(b);
+    cache.field(c);
+    EXPECT_EQUAL(cache.size(), 2);
+    EXPECT_EQUAL(cache.misses(), 3);
+    cache.field(b);
+    EXPECT_EQUAL(cache.misses(), 3);
+    cache.field(a);
+    EXPECT_EQUAL(cache.misses(), 4);
+    EXPECT_ERROR(cache.field({41, 0}));
+    EXPECT_ERROR(DistanceFieldCache(maze, 0));
+}
+
+STUDENT_TEST("solveQueries answers every query like breadth-first search, in order") {
+    MazeBits maze = generateMaze(31, 45, 0.2);
+    for (int numSources : {1, 7, 200}) {
+        Vector<MazeQuery> queries = randomQueries(maze, 200, numSources);
+        Vector<Vector<GridLocation>> paths = solveQueries(maze, queries);
+        EXPECT_EQUAL(paths.size(), queries.size());
+        PathValidator validator;
+        for (int i = 0; i < queries.size(); i++) {
+            EXPECT_EQUAL(paths[i].size(), bfsShortestPath(maze, queries[i].start, queries[i].goal).size());
+            EXPECT(validator.check(maze, &paths[i][0], paths[i].size(), queries[i].start, queries[i].goal) == nullptr);
+        }
+    }
+}
+
+STUDENT_TEST("Time 10k random queries: BFS each time, distance field cache, batch") {
+    MazeBits maze = generateMaze(501, 501, 0.1);
+    for (int numSources : {10, 100, 1000}) {
+        Vector<MazeQuery> queries = randomQueries(maze, 10000, numSources);
+        cout << numSources << " distinct sources" << endl;
+        if (numSources == 10) {
+            // every query searches the whole maze, so time a tenth of them
+            TIME_OPERATION(queries.size() / 10, answerWithBFS(maze, queries.subList(0, queries.size() / 10)));
+        }
+        TIME_OPERATION(queries.size(), answerWithCache(maze, queries, numSources));
+        TIME_OPERATION(queries.size(), answerInBatch(maze, queries));
+    }
+}
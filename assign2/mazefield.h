@@ -0,0 +1,77 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "gridlocation.h"
+#include "mazebits.h"
+#include "vector.h"
+
+/*
+ * Breadth-first distance from a set of source cells to every cell of a maze,
+ * -1 for walls and unreachable cells. With more than one source each cell
+ * holds the distance to its nearest source. Any open cell at distance d > 0
+ * has a neighbor at distance d - 1, so a shortest path to a goal is found by
+ * walking downhill from the goal in O(path length), without searching again.
+ */
+class DistanceField {
+public:
+    DistanceField(const MazeBits& maze, GridLocation source);
+    DistanceField(const MazeBits& maze, const Vector<GridLocation>& sources);
+
+    int numRows() const { return rows; }
+    int numCols() const { return cols; }
+    int distance(GridLocation goal) const;
+    Vector<GridLocation> pathTo(GridLocation goal) const;
+    Vector<GridLocation> pathFrom(GridLocation goal) const;
+    long long memoryUsage() const;
+
+private:
+    void build(const MazeBits& maze, const Vector<GridLocation>& sources);
+
+    int rows;
+    int cols;
+    std::vector<int> dist;
+};
+
+/*
+ * Least recently used cache of single-source distance fields for one maze,
+ * keyed by source cell. A query whose start or goal already has a field costs
+ * O(path length); otherwise the field of its start is built and cached. The
+ * maze must outlive the cache.
+ */
+class DistanceFieldCache {
+public:
+    DistanceFieldCache(const MazeBits& maze, int capacity = 16);
+
+    std::shared_ptr<const DistanceField> field(GridLocation source);
+    Vector<GridLocation> shortestPath(GridLocation start, GridLocation goal);
+    int distance(GridLocation start, GridLocation goal);
+
+    int size() const { return entries.size(); }
+    long long hits() const { return numHits; }
+    long long misses() const { return numMisses; }
+
+private:
+    typedef std::pair<int, std::shared_ptr<const DistanceField>> Entry;
+
+    std::shared_ptr<const DistanceField> cached(int cell);
+
+    const MazeBits& maze;
+    int capacity;
+    std::list<Entry> entries;   // most recently used at the front
+    std::unordered_map<int, std::list<Entry>::iterator> lookupTable;
+    long long numHits;
+    long long numMisses;
+};
+
+/*
+ * One (start, goal) query of a batch
+ */
+struct MazeQuery {
+    GridLocation start;
+    GridLocation goal;
+};
+
+Vector<Vector<GridLocation>> solveQueries(const MazeBits& maze, const Vector<MazeQuery>& queries);
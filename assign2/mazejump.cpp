@@ -0,0 +1,389 @@
+#include <iostream>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <queue>
+#include <vector>
+#include "error.h"
+#include "grid.h"
+#include "maze.h"
+#include "mazebits.h"
+#include "mazejump.h"
+#include "mazesearch.h"
+#include "testing/SimpleTest.h"
+using namespace std;
+
+/*
+ * Jump point search for 4-connected mazes.
+ *
+ * Among the many equally short paths through open space, the search only
+ * follows one canonical path: vertical runs may branch left and right at
+ * every cell, while a horizontal run goes straight and only branches up or
+ * down right past the corner of a wall (a "forced" neighbor), where a shortest
+ * path may need to turn. A jump moves in one direction until it reaches the
+ * exit or a cell where such a branch is possible (a jump point), without
+ * putting the cells in between on the frontier. A vertical jump stops at any
+ * cell from which a horizontal jump finds a jump point or the exit.
+ */
+
+const int kUp = 0, kDown = 1, kLeft = 2, kRight = 3;
+const int kRowStep[4] = {-1, 1, 0, 0};
+const int kColStep[4] = {0, 0, -1, 1};
+
+/*
+ * Whether a horizontal move in direction <dc> into (row, col) passes the
+ * corner of a wall above (<dr> = -1) or below (<dr> = 1), so the path may turn there
+ */
+static inline bool forcedTurn(const MazeBits& maze, int row, int col, int dc, int dr) {
+    return !maze.isOpen(row + dr, col - dc) && maze.isOpen(row + dr, col);
+}
+
+static inline bool hasForcedTurn(const MazeBits& maze, int row, int col, int dc) {
+    return forcedTurn(maze, row, col, dc, -1) || forcedTurn(maze, row, col, dc, 1);
+}
+
+/*
+ * Fill the table one line at a time, walking each line against the jump
+ * direction so every entry extends the one for the next cell along the jump.
+ * Horizontal entries come first, as a vertical jump stops at any cell where a
+ * horizontal jump would find a jump point.
+ */
+JumpTable::JumpTable(const MazeBits& maze) : jumps(4 * (size_t) maze.numCells(), 0) {
+    int rows = maze.numRows();
+    int cols = maze.numCols();
+
+    // extend the entry of <next> by one more step, or stop at it if it is a jump point
+    auto extend = [this](int cell, int dir, int next, bool stopAtNext) {
+        int further = jumps[4 * next + dir];
+        jumps[4 * cell + dir] = stopAtNext ? 1 : (further > 0 ? further + 1 : further - 1);
+    };
+
+    for (int r = 0; r < rows; r++) {
+        for (int c = cols - 2; c >= 0; c--) {
+            if (maze.isOpen(r, c) && maze.isOpen(r, c + 1)) {
+                extend(maze.cellOf(r, c), kRight, maze.cellOf(r, c + 1), hasForcedTurn(maze, r, c + 1, 1));
+            }
+        }
+        for (int c = 1; c < cols; c++) {
+            if (maze.isOpen(r, c) && maze.isOpen(r, c - 1)) {
+                extend(maze.cellOf(r, c), kLeft, maze.cellOf(r, c - 1), hasForcedTurn(maze, r, c - 1, -1));
+            }
+        }
+    }
+
+    auto horizontalJumpPoint = [this](int cell) {
+        return jumps[4 * cell + kLeft] > 0 || jumps[4 * cell + kRight] > 0;
+    };
+    for (int c = 0; c < cols; c++) {
+        for (int r = rows - 2; r >= 0; r--) {
+            if (maze.isOpen(r, c) && maze.isOpen(r + 1, c)) {
+                int next = maze.cellOf(r + 1, c);
+                extend(maze.cellOf(r, c), kDown, next, horizontalJumpPoint(next));
+            }
+        }
+        for (int r = 1; r < rows; r++) {
+            if (maze.isOpen(r, c) && maze.isOpen(r - 1, c)) {
+                int next = maze.cellOf(r - 1, c);
+                extend(maze.cellOf(r, c), kUp, next, horizontalJumpPoint(next));
+            }
+        }
+    }
+}
+
+long long JumpTable::memoryUsage() const {
+    return sizeof(*this) + jumps.capacity() * sizeof(int);
+}
+
+
+/*
+ * State shared by the jumps of one search
+ */
+struct JumpSearch {
+    const MazeBits& maze;
+    const JumpTable* table;
+    int goal;
+    int goalRow;
+    int goalCol;
+
+    int jump(int row, int col, int dir) const;
+    int jumpHorizontal(int row, int col, int dc) const;
+    int jumpVertical(int row, int col, int dr) const;
+    int jumpWithTable(int row, int col, int dir) const;
+};
+
+/*
+ * Step from (row, col) in direction <dc> until reaching the goal, a cell with
+ * a forced turn, or a wall
+ * @return The cell reached, or -1 for a wall
+ */
+int JumpSearch::jumpHorizontal(int row, int col, int dc) const {
+    while (true) {
+        col += dc;
+        if (!maze.isOpen(row, col)) {
+            return -1;
+        }
+        int cell = maze.cellOf(row, col);
+        if (cell == goal || hasForcedTurn(maze, row, col, dc)) {
+            return cell;
+        }
+    }
+}
+
+/*
+ * Step from (row, col) in direction <dr> until reaching the goal, a cell from
+ * which a horizontal jump succeeds, or a wall
+ * @return The cell reached, or -1 for a wall
+ */
+int JumpSearch::jumpVertical(int row, int col, int dr) const {
+    while (true) {
+        row += dr;
+        if (!maze.isOpen(row, col)) {
+            return -1;
+        }
+        int cell = maze.cellOf(row, col);
+        if (cell == goal || jumpHorizontal(row, col, -1) >= 0 || jumpHorizontal(row, col, 1) >= 0) {
+            return cell;
+        }
+    }
+}
+
+/*
+ * The same jumps as above in O(1), from the precomputed table. The table knows
+ * nothing about the goal, so a jump also stops where it passes the goal, or
+ * for a vertical jump, where it crosses a row from which the goal is in reach.
+ */
+int JumpSearch::jumpWithTable(int row, int col, int dir) const {
+    int cell = maze.cellOf(row, col);
+    int dist = table->distance(cell, dir);
+    int reach = abs(dist);
+    int stop = dist > 0 ? dist : INT_MAX;
+
+    if (kRowStep[dir] == 0) {
+        int toGoal = (goalCol - col) * kColStep[dir];
+        if (goalRow == row && toGoal >= 1 && toGoal <= reach) {
+            stop = min(stop, toGoal);
+        }
+    } else {
+        int toGoalRow = (goalRow - row) * kRowStep[dir];
+        if (toGoalRow >= 1 && toGoalRow <= reach) {
+            int crossing = maze.cellOf(goalRow, col);
+            int across = table->distance(crossing, goalCol > col ? kRight : kLeft);
+            if (abs(goalCol - col) <= abs(across)) {
+                stop = min(stop, toGoalRow);
+            }
+        }
+    }
+
+    if (stop == INT_MAX) {
+        return -1;
+    }
+    return maze.cellOf(row + stop * kRowStep[dir], col + stop * kColStep[dir]);
+}
+
+int JumpSearch::jump(int row, int col, int dir) const {
+    if (table != nullptr) {
+        return jumpWithTable(row, col, dir);
+    } else if (kRowStep[dir] == 0) {
+        return jumpHorizontal(row, col, kColStep[dir]);
+    } else {
+        return jumpVertical(row, col, kRowStep[dir]);
+    }
+}
+
+/*
+ * Find a shortest path with jump point search: A* over jump points, where the
+ * cost of a jump is its length, ordered by a binary heap.
+ *
+ * @param table If not null, precomputed jumps for this maze (JPS+)
+ * @param stats If not null, receives the number of expanded jump points and the time taken
+ * @return The locations of a shortest path from entry to exit, or an empty
+ *         Vector if exit cannot be reached
+ */
+Vector<GridLocation> jumpPointSearch(const MazeBits& maze, GridLocation entry, GridLocation exit,
+                                     const JumpTable* table, SearchStats* stats) {
+    SearchStats local;
+    auto begin = chrono::steady_clock::now();
+    Vector<GridLocation> path;
+
+    if (maze.isOpen(entry.row, entry.col) && maze.isOpen(exit.row, exit.col)) {
+        JumpSearch search = {maze, table, maze.cellOf(exit), exit.row, exit.col};
+        int start = maze.cellOf(entry);
+        auto heuristic = [&maze, &exit](int cell) {
+            GridLocation loc = maze.locationOf(cell);
+            return abs(loc.row - exit.row) + abs(loc.col - exit.col);
+        };
+
+        typedef pair<int, int> Entry;   // (g + h, cell)
+        priority_queue<Entry, vector<Entry>, greater<Entry>> frontier;
+        vector<int> dist(maze.numCells(), -1);
+        vector<int> parent(maze.numCells(), -1);
+        dist[start] = 0;
+        parent[start] = start;
+        frontier.push(Entry(heuristic(start), start));
+
+        while (!frontier.empty()) {
+            int f = frontier.top().first;
+            int cur = frontier.top().second;
+            frontier.pop();
+            if (f != dist[cur] + heuristic(cur)) {
+                continue;   // stale entry
+            }
+            local.expanded++;
+            if (cur == search.goal) {
+                break;
+            }
+
+            // prune the directions that a canonical path cannot take from here
+            GridLocation loc = maze.locationOf(cur);
+            GridLocation from = maze.locationOf(parent[cur]);
+            bool dirs[4] = {true, true, true, true};
+            if (from.row == loc.row && from.col != loc.col) {
+                int dc = loc.col > from.col ? 1 : -1;
+                dirs[dc > 0 ? kLeft : kRight] = false;
+                dirs[kUp] = forcedTurn(maze, loc.row, loc.col, dc, -1);
+                dirs[kDown] = forcedTurn(maze, loc.row, loc.col, dc, 1);
+            } else if (from.col == loc.col && from.row != loc.row) {
+                dirs[loc.row > from.row ? kUp : kDown] = false;
+            }
+
+            for (int dir = 0; dir < 4; dir++) {
+                if (!dirs[dir]) {
+                    continue;
+                }
+                int next = search.jump(loc.row, loc.col, dir);
+                if (next < 0) {
+                    continue;
+                }
+                GridLocation to = maze.locationOf(next);
+                int newDist = dist[cur] + abs(to.row - loc.row) + abs(to.col - loc.col);
+                if (dist[next] < 0 || newDist < dist[next]) {
+                    dist[next] = newDist;
+                    parent[next] = cur;
+                    frontier.push(Entry(newDist + heuristic(next), next));
+                }
+            }
+        }
+
+        // walk back over the jump points, filling in the straight runs between them
+        if (dist[search.goal] >= 0) {
+            for (int cell = search.goal; ; cell = parent[cell]) {
+                GridLocation to = maze.locationOf(cell);
+                if (parent[cell] == cell) {
+                    path.add(to);
+                    break;
+                }
+                GridLocation from = maze.locationOf(parent[cell]);
+                int dr = (from.row > to.row) - (from.row < to.row);
+                int dc = (from.col > to.col) - (from.col < to.col);
+                for (GridLocation step = to; step != from; step = GridLocation(step.row + dr, step.col + dc)) {
+                    path.add(step);
+                }
+            }
+            path.reverse();
+        }
+    }
+
+    local.seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    if (stats != nullptr) {
+        *stats = local;
+    }
+    return path;
+}
+
+
+/* * * * * * Test Cases * * * * * */
+
+/* Test helper to make an open grid with a fraction of random cells blocked,
+ * keeping the corners open */
+static MazeBits scatteredMaze(int rows, int cols, double blocked) {
+    MazeBits maze(rows, cols);
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < cols; c++) {
+            maze.setOpen(r, c, !randomChance(blocked));
+        }
+    }
+    maze.setOpen(0, 0, true);
+    maze.setOpen(rows - 1, cols - 1, true);
+    return maze;
+}
+
+STUDENT_TEST("JumpTable distances on a single corridor row") {
+    Grid<bool> grid = {{true, true, true, true}};
+    JumpTable table{MazeBits(grid)};
+    EXPECT_EQUAL(table.distance(0, kRight), -3);
+    EXPECT_EQUAL(table.distance(3, kLeft), -3);
+    EXPECT_EQUAL(table.distance(1, kUp), 0);
+}
+
+STUDENT_TEST("jumpPointSearch with and without table matches BFS length") {
+    for (int trial = 0; trial < 300; trial++) {
+        int rows = randomInteger(1, 40);
+        int cols = randomInteger(1, 40);
+        MazeBits maze = trial % 2 == 0 ? scatteredMaze(rows, cols, randomReal(0, 0.4))
+                                       : generateMaze(rows, cols, randomReal(0, 1));
+        JumpTable table(maze);
+        GridLocation entry = {randomInteger(0, rows - 1), randomInteger(0, cols - 1)};
+        GridLocation exit = {randomInteger(0, rows - 1), randomInteger(0, cols - 1)};
+        int expected = bfsShortestPath(maze, entry, exit).size();
+
+        Vector<GridLocation> online = jumpPointSearch(maze, entry, exit);
+        Vector<GridLocation> cached = jumpPointSearch(maze, entry, exit, &table);
+        EXPECT_EQUAL(online.size(), expected);
+        EXPECT_EQUAL(cached.size(), expected);
+        if (expected > 0 && entry == GridLocation(0, 0) && exit == GridLocation(rows - 1, cols - 1)) {
+            Grid<bool> grid = maze.toGrid();
+            EXPECT_NO_ERROR(validatePath(grid, toStack(online)));
+        }
+        // a path that starts and ends correctly and moves one open cell at a time
+        for (const Vector<GridLocation>& path : {online, cached}) {
+            for (int i = 0; i < path.size(); i++) {
+                EXPECT(maze.isOpen(path[i].row, path[i].col));
+                if (i > 0) {
+                    EXPECT_EQUAL(abs(path[i].row - path[i-1].row) + abs(path[i].col - path[i-1].col), 1);
+                }
+            }
+            if (!path.isEmpty()) {
+                EXPECT_EQUAL(path[0], entry);
+                EXPECT_EQUAL(path[path.size() - 1], exit);
+            }
+        }
+    }
+}
+
+STUDENT_TEST("jumpPointSearch on res mazes passes validatePath") {
+    Vector<string> files = {"res/5x7.maze", "res/21x23.maze", "res/33x41.maze"};
+    for (const string& file : files) {
+        Grid<bool> grid;
+        readMazeFile(file, grid);
+        MazeBits maze(grid);
+        JumpTable table(maze);
+        GridLocation exit = {grid.numRows() - 1, grid.numCols() - 1};
+        EXPECT_NO_ERROR(validatePath(grid, toStack(jumpPointSearch(maze, {0, 0}, exit))));
+        EXPECT_NO_ERROR(validatePath(grid, toStack(jumpPointSearch(maze, {0, 0}, exit, &table))));
+    }
+}
+
+STUDENT_TEST("Time BFS against JPS and JPS+ on open and corridor mazes") {
+    Vector<int> sizes = {501, 2001};
+    for (int size : sizes) {
+        Vector<MazeBits> mazes = {scatteredMaze(size, size, 0), scatteredMaze(size, size, 0.2),
+                                  generateMaze(size, size, 0.5), generateMaze(size, size, 0)};
+        Vector<string> names = {"open", "scattered 20%", "corridors with loops", "perfect maze"};
+        for (int i = 0; i < mazes.size(); i++) {
+            const MazeBits& maze = mazes[i];
+            GridLocation exit = {size - 1, size - 1};
+            SearchStats bfs, jps, jpsPlus;
+            shortestPath(maze, {0, 0}, exit, SearchMode::BFS, &bfs);
+            jumpPointSearch(maze, {0, 0}, exit, nullptr, &jps);
+            auto begin = chrono::steady_clock::now();
+            JumpTable table(maze);
+            double buildSeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+            jumpPointSearch(maze, {0, 0}, exit, &table, &jpsPlus);
+            cout << "    " << size << "x" << size << " " << names[i]
+                 << ": BFS expanded=" << bfs.expanded << " secs=" << bfs.seconds
+                 << " | JPS expanded=" << jps.expanded << " secs=" << jps.seconds
+                 << " | JPS+ expanded=" << jpsPlus.expanded << " secs=" << jpsPlus.seconds
+                 << " (table " << buildSeconds << " secs, " << table.memoryUsage() / (1 << 20) << " MB)" << endl;
+        }
+    }
+}
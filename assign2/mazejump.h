@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+#include "gridlocation.h"
+#include "mazebits.h"
+#include "mazesearch.h"
+#include "vector.h"
+
+/*
+ * Precomputed jump distances for jump point search (JPS+). For every open cell
+ * and each of the four directions it holds how far a jump in that direction
+ * travels: a positive d means the jump stops at a jump point d cells away, and
+ * zero or a negative -d means there is none and the last open cell before a
+ * wall or the edge is d cells away. The table depends only on the maze, so one
+ * table can be cached and shared by every query against that maze.
+ */
+class JumpTable {
+public:
+    JumpTable(const MazeBits& maze);
+
+    int distance(int cell, int dir) const { return jumps[4 * cell + dir]; }
+    long long memoryUsage() const;
+
+private:
+    std::vector<int> jumps;     // four entries per cell, in the order up, down, left, right
+};
+
+Vector<GridLocation> jumpPointSearch(const MazeBits& maze, GridLocation entry, GridLocation exit,
+                                     const JumpTable* table = nullptr, SearchStats* stats = nullptr);
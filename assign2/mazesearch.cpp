@@ -0,0 +1,603 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+#include "error.h"
+#include "filelib.h"
+#include "grid.h"
+#include "maze.h"
+#include "mazebits.h"
+#include "mazejump.h"
+#include "mazesearch.h"
+#include "stack.h"
+#include "strlib.h"
+#include "vector.h"
+#include "testing/SimpleTest.h"
+using namespace std;
+
+/* * * * * * CellQueue * * * * * */
+
+CellQueue::CellQueue(int capacity) : head(0), tail(0) {
+    unsigned size = 1;
+    while (size < (unsigned) max(capacity, 1)) {
+        size *= 2;
+    }
+    buffer.resize(size);
+    mask = size - 1;
+}
+
+/*
+ * Double the capacity, unrolling the queued cells to the front of the new buffer
+ */
+void CellQueue::grow() {
+    vector<int> bigger(buffer.size() * 2);
+    int count = size();
+    for (int i = 0; i < count; i++) {
+        bigger[i] = buffer[(head + i) & mask];
+    }
+    buffer.swap(bigger);
+    mask = buffer.size() - 1;
+    head = 0;
+    tail = count;
+}
+
+
+/* * * * * * Searches * * * * * */
+
+/*
+ * Store the open neighbors of <cell> (up, down, left, right) in <out>
+ * @return The number of neighbors stored
+ */
+static inline int openNeighbors(const MazeBits& maze, int cell, int out[4]) {
+    int cols = maze.numCols();
+    int col = cell % cols;
+    int count = 0;
+    if (cell >= cols && maze.isOpen(cell - cols)) out[count++] = cell - cols;
+    if (cell + cols < maze.numCells() && maze.isOpen(cell + cols)) out[count++] = cell + cols;
+    if (col > 0 && maze.isOpen(cell - 1)) out[count++] = cell - 1;
+    if (col < cols - 1 && maze.isOpen(cell + 1)) out[count++] = cell + 1;
+    return count;
+}
+
+/*
+ * Follow <parent> links back from <goal> to the cell that is its own parent
+ * @return The locations from that start cell to <goal>
+ */
+static Vector<GridLocation> tracePath(const MazeBits& maze, const vector<int>& parent, int goal) {
+    Vector<GridLocation> path;
+    int cell = goal;
+    while (true) {
+        path.add(maze.locationOf(cell));
+        if (parent[cell] == cell) {
+            break;
+        }
+        cell = parent[cell];
+    }
+    path.reverse();
+    return path;
+}
+
+/*
+ * Breadth-first search from <start> to <goal>. Cells are visited in order of
+ * distance, so the first time <goal> is dequeued its parent chain is a shortest
+ * path. The parent array doubles as the visited set, so besides it and the
+ * queue nothing is allocated, and the search runs in O(cells).
+ */
+static Vector<GridLocation> bfsSearch(const MazeBits& maze, int start, int goal, SearchStats& stats) {
+    vector<int> parent(maze.numCells(), -1);
+    CellQueue queue(2 * (maze.numRows() + maze.numCols()));
+
+    parent[start] = start;
+    queue.enqueue(start);
+    while (!queue.isEmpty()) {
+        int cur = queue.dequeue();
+        stats.expanded++;
+        if (cur == goal) {
+            return tracePath(maze, parent, goal);
+        }
+        int next[4];
+        int count = openNeighbors(maze, cur, next);
+        for (int i = 0; i < count; i++) {
+            if (parent[next[i]] < 0) {
+                parent[next[i]] = cur;
+                queue.enqueue(next[i]);
+            }
+        }
+    }
+    return Vector<GridLocation>();
+}
+
+/*
+ * A* search from <start> to <goal> with the Manhattan distance as heuristic.
+ *
+ * With unit steps the Manhattan distance is consistent, and a step changes
+ * f = g + h by either 0 (towards the goal) or +2 (away from it). The priority
+ * queue is therefore a radix heap reduced to two buckets, f and f + 2, both
+ * plain arrays: push and pop are O(1). Within a bucket the most recent cell
+ * is expanded first, which prefers deeper cells among equal f. A cell whose
+ * distance improves is pushed again and its stale entry skipped when popped.
+ */
+static Vector<GridLocation> astarSearch(const MazeBits& maze, int start, int goal, SearchStats& stats) {
+    int cols = maze.numCols();
+    int goalRow = goal / cols;
+    int goalCol = goal % cols;
+    auto heuristic = [cols, goalRow, goalCol](int cell) {
+        return abs(cell / cols - goalRow) + abs(cell % cols - goalCol);
+    };
+
+    vector<int> parent(maze.numCells(), -1);
+    vector<int> dist(maze.numCells(), -1);
+    vector<int> current, next;
+    int currentF = heuristic(start);
+
+    parent[start] = start;
+    dist[start] = 0;
+    current.push_back(start);
+    while (!current.empty() || !next.empty()) {
+        if (current.empty()) {
+            current.swap(next);
+            currentF += 2;
+        }
+        int cur = current.back();
+        current.pop_back();
+        if (dist[cur] + heuristic(cur) != currentF) {
+            continue;   // stale entry, the cell was pushed again with a shorter distance
+        }
+        stats.expanded++;
+        if (cur == goal) {
+            return tracePath(maze, parent, goal);
+        }
+        int neighbors[4];
+        int count = openNeighbors(maze, cur, neighbors);
+        for (int i = 0; i < count; i++) {
+            int cell = neighbors[i];
+            if (dist[cell] < 0 || dist[cur] + 1 < dist[cell]) {
+                dist[cell] = dist[cur] + 1;
+                parent[cell] = cur;
+                if (dist[cell] + heuristic(cell) == currentF) {
+                    current.push_back(cell);
+                } else {
+                    next.push_back(cell);
+                }
+            }
+        }
+    }
+    return Vector<GridLocation>();
+}
+
+/*
+ * Expand every cell of one breadth-first level of one side of a bidirectional
+ * search. A neighbor already reached by the other side closes a path; the
+ * shortest such path over the whole level is kept in <bestLength>, <meetFrom>
+ * and <meetTo>.
+ */
+static void expandLevel(const MazeBits& maze, CellQueue& frontier, uint8_t side,
+                        vector<uint8_t>& owner, vector<int>& parent, vector<int>& dist,
+                        int& bestLength, int& meetFrom, int& meetTo, SearchStats& stats) {
+    for (int n = frontier.size(); n > 0; n--) {
+        int cur = frontier.dequeue();
+        stats.expanded++;
+        int next[4];
+        int count = openNeighbors(maze, cur, next);
+        for (int i = 0; i < count; i++) {
+            int cell = next[i];
+            if (owner[cell] == 0) {
+                owner[cell] = side;
+                parent[cell] = cur;
+                dist[cell] = dist[cur] + 1;
+                frontier.enqueue(cell);
+            } else if (owner[cell] != side && dist[cur] + 1 + dist[cell] < bestLength) {
+                bestLength = dist[cur] + 1 + dist[cell];
+                meetFrom = cur;
+                meetTo = cell;
+            }
+        }
+    }
+}
+
+/*
+ * Bidirectional breadth-first search: one search grows from <start>, one from
+ * <goal>, and each round expands a whole level of the smaller frontier. Each
+ * cell belongs to the side that reached it first, so the two sides share one
+ * parent and one distance array. The search stops after the first level on
+ * which the frontiers touch, as no later level can produce a shorter path.
+ */
+static Vector<GridLocation> bidirectionalSearch(const MazeBits& maze, int start, int goal, SearchStats& stats) {
+    const uint8_t forward = 1, backward = 2;
+    vector<uint8_t> owner(maze.numCells(), 0);
+    vector<int> parent(maze.numCells(), -1);
+    vector<int> dist(maze.numCells(), 0);
+    CellQueue fromStart(maze.numRows() + maze.numCols());
+    CellQueue fromGoal(maze.numRows() + maze.numCols());
+
+    if (start == goal) {
+        stats.expanded++;
+        return Vector<GridLocation>({maze.locationOf(start)});
+    }
+    owner[start] = forward;
+    parent[start] = start;
+    fromStart.enqueue(start);
+    owner[goal] = backward;
+    parent[goal] = goal;
+    fromGoal.enqueue(goal);
+
+    int bestLength = INT32_MAX;
+    int meetFrom = -1, meetTo = -1;
+    while (bestLength == INT32_MAX && !fromStart.isEmpty() && !fromGoal.isEmpty()) {
+        if (fromStart.size() <= fromGoal.size()) {
+            expandLevel(maze, fromStart, forward, owner, parent, dist, bestLength, meetFrom, meetTo, stats);
+        } else {
+            expandLevel(maze, fromGoal, backward, owner, parent, dist, bestLength, meetFrom, meetTo, stats);
+        }
+    }
+    if (bestLength == INT32_MAX) {
+        return Vector<GridLocation>();
+    }
+
+    // meetFrom and meetTo are adjacent cells owned by different sides
+    if (owner[meetFrom] == backward) {
+        swap(meetFrom, meetTo);
+    }
+    Vector<GridLocation> path = tracePath(maze, parent, meetFrom);
+    for (int cell = meetTo; ; cell = parent[cell]) {
+        path.add(maze.locationOf(cell));
+        if (parent[cell] == cell) {
+            break;
+        }
+    }
+    return path;
+}
+
+/*
+ * Find a shortest path from <entry> to <exit> using the given search mode
+ *
+ * @param stats If not null, receives the number of expanded cells and the time taken
+ * @return The locations of the path from entry to exit, or an empty Vector if
+ *         exit cannot be reached
+ */
+Vector<GridLocation> shortestPath(const MazeBits& maze, GridLocation entry, GridLocation exit,
+                                  SearchMode mode, SearchStats* stats) {
+    SearchStats local;
+    auto begin = chrono::steady_clock::now();
+    Vector<GridLocation> path;
+
+    if (maze.isOpen(entry.row, entry.col) && maze.isOpen(exit.row, exit.col)) {
+        int start = maze.cellOf(entry);
+        int goal = maze.cellOf(exit);
+        switch (mode) {
+        case SearchMode::BFS:
+            path = bfsSearch(maze, start, goal, local);
+            break;
+        case SearchMode::AStar:
+            path = astarSearch(maze, start, goal, local);
+            break;
+        case SearchMode::Bidirectional:
+            path = bidirectionalSearch(maze, start, goal, local);
+            break;
+        case SearchMode::JumpPoint:
+            path = jumpPointSearch(maze, entry, exit, nullptr, &local);
+            break;
+        }
+    }
+
+    local.seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    if (stats != nullptr) {
+        *stats = local;
+    }
+    return path;
+}
+
+/*
+ * @return The locations of a shortest path from entry to exit found by
+ *         breadth-first search, or an empty Vector if exit cannot be reached
+ */
+Vector<GridLocation> bfsShortestPath(const MazeBits& maze, GridLocation entry, GridLocation exit) {
+    return shortestPath(maze, entry, exit, SearchMode::BFS);
+}
+
+/*
+ * Convert a path from entry to exit into the Stack form used by validatePath,
+ * with the exit on top
+ */
+Stack<GridLocation> toStack(const Vector<GridLocation>& path) {
+    Stack<GridLocation> result;
+    for (const GridLocation& loc : path) {
+        result.push(loc);
+    }
+    return result;
+}
+
+/*
+ * Variant of solveMaze that returns a shortest path, found with the given mode
+ */
+Stack<GridLocation> solveMaze(Grid<bool>& maze, SearchMode mode) {
+    MazeBits bits(maze);
+    Vector<GridLocation> path = shortestPath(bits, {0, 0}, {maze.numRows() - 1, maze.numCols() - 1}, mode);
+    if (path.isEmpty()) {
+        error("An unsolved maze is passed in");
+    }
+    return toStack(path);
+}
+
+/*
+ * Drop-in replacement for solveMaze that returns a shortest path
+ */
+Stack<GridLocation> solveMazeBFS(Grid<bool>& maze) {
+    return solveMaze(maze, SearchMode::BFS);
+}
+
+
+/* * * * * * Validation * * * * * */
+
+/*
+ * Check the path <path>[0..length) against the same rules as validatePath:
+ * it must begin at <entry>, end at <exit>, and move one step up, down, left or
+ * right at a time through corridors without visiting any cell twice. Checking
+ * stops at the first violation.
+ *
+ * @return nullptr for a valid path, or else a description of the first violation
+ */
+const char* PathValidator::check(const MazeBits& maze, const GridLocation* path, int length,
+                                 GridLocation entry, GridLocation exit) {
+    if (length == 0) {
+        return "Path is empty";
+    }
+    if (path[0] != entry) {
+        return "Path does not begin at maze entry";
+    }
+    if (path[length - 1] != exit) {
+        return "Path does not end at maze exit";
+    }
+    if ((int) visited.size() < maze.numBytes()) {
+        visited.resize(maze.numBytes(), 0);
+    }
+
+    const char* problem = nullptr;
+    int marked = 0;
+    for (; marked < length; marked++) {
+        const GridLocation& cur = path[marked];
+        if (!maze.isOpen(cur.row, cur.col)) {
+            problem = "Path go through walls";
+            break;
+        }
+        if (marked > 0 && abs(cur.row - path[marked - 1].row) + abs(cur.col - path[marked - 1].col) != 1) {
+            problem = "Path has teleports";
+            break;
+        }
+        int cell = maze.cellOf(cur);
+        uint8_t bit = 1 << (cell & 7);
+        if (visited[cell >> 3] & bit) {
+            problem = "Path has revisit";
+            break;
+        }
+        visited[cell >> 3] |= bit;
+    }
+
+    // leave the bitmap clear for the next call, touching only the cells marked here
+    for (int i = 0; i < marked; i++) {
+        int cell = maze.cellOf(path[i]);
+        visited[cell >> 3] &= ~(1 << (cell & 7));
+    }
+    return problem;
+}
+
+/*
+ * Check a path from the maze entry (0, 0) to the exit in the bottom right corner
+ */
+const char* PathValidator::check(const MazeBits& maze, const GridLocation* path, int length) {
+    return check(maze, path, length, {0, 0}, {maze.numRows() - 1, maze.numCols() - 1});
+}
+
+/*
+ * Like validatePath, raise an error if the path from entry to exit is invalid
+ */
+void PathValidator::validate(const MazeBits& maze, const GridLocation* path, int length) {
+    const char* problem = check(maze, path, length);
+    if (problem != nullptr) {
+        error(problem);
+    }
+}
+
+
+/* * * * * * Test Cases * * * * * */
+
+/* Test helper to list the .maze files in res */
+static Vector<string> mazeFiles() {
+    Vector<string> files;
+    for (const string& name : listDirectory("res")) {
+        if (endsWith(name, ".maze")) {
+            files.add("res/" + name);
+        }
+    }
+    return files;
+}
+
+/* Test helpers to validate the same path <rounds> times */
+static void validateRepeatedly(Grid<bool>& maze, const Stack<GridLocation>& path, int rounds) {
+    for (int i = 0; i < rounds; i++) {
+        validatePath(maze, path);
+    }
+}
+
+static void validateRepeatedly(const MazeBits& maze, const Vector<GridLocation>& path, int rounds) {
+    PathValidator validator;
+    for (int i = 0; i < rounds; i++) {
+        validator.validate(maze, &path[0], path.size());
+    }
+}
+
+STUDENT_TEST("CellQueue keeps FIFO order while wrapping and growing") {
+    CellQueue queue(4);
+    int next = 0, expected = 0;
+    for (int round = 0; round < 50; round++) {
+        for (int i = 0; i < round % 7 + 1; i++) {
+            queue.enqueue(next++);
+        }
+        for (int i = 0; i < round % 5 && !queue.isEmpty(); i++) {
+            EXPECT_EQUAL(queue.dequeue(), expected++);
+        }
+    }
+    EXPECT_EQUAL(queue.size(), next - expected);
+    while (!queue.isEmpty()) {
+        EXPECT_EQUAL(queue.dequeue(), expected++);
+    }
+}
+
+STUDENT_TEST("solveMazeBFS on all res mazes, valid and no longer than solveMaze") {
+    for (const string& file : mazeFiles()) {
+        Grid<bool> maze;
+        readMazeFile(file, maze);
+        Stack<GridLocation> shortest = solveMazeBFS(maze);
+        EXPECT_NO_ERROR(validatePath(maze, shortest));
+        EXPECT(shortest.size() <= solveMaze(maze).size());
+    }
+}
+
+STUDENT_TEST("bfsShortestPath finds the shorter of two routes") {
+    Grid<bool> maze = {{true,  true,  true,  true},
+                       {true,  false, false, true},
+                       {true,  true,  true,  true}};
+    Vector<GridLocation> path = bfsShortestPath(MazeBits(maze), {0, 0}, {2, 3});
+    EXPECT_EQUAL(path.size(), 6);
+    EXPECT_NO_ERROR(validatePath(maze, toStack(path)));
+}
+
+STUDENT_TEST("bfsShortestPath on unreachable exit returns empty path") {
+    Grid<bool> maze = {{true, false},
+                       {false, true}};
+    EXPECT(bfsShortestPath(MazeBits(maze), {0, 0}, {1, 1}).isEmpty());
+    EXPECT_ERROR(solveMazeBFS(maze));
+}
+
+STUDENT_TEST("All search modes find valid paths of the same length") {
+    Vector<SearchMode> modes = {SearchMode::BFS, SearchMode::AStar, SearchMode::Bidirectional, SearchMode::JumpPoint};
+    for (const string& file : mazeFiles()) {
+        Grid<bool> maze;
+        readMazeFile(file, maze);
+        int shortest = solveMazeBFS(maze).size();
+        for (SearchMode mode : modes) {
+            Stack<GridLocation> path = solveMaze(maze, mode);
+            EXPECT_NO_ERROR(validatePath(maze, path));
+            EXPECT_EQUAL(path.size(), shortest);
+        }
+    }
+    for (int trial = 0; trial < 20; trial++) {
+        MazeBits maze = generateMaze(randomInteger(1, 60), randomInteger(1, 60), randomReal(0, 1));
+        GridLocation exit = {maze.numRows() - 1, maze.numCols() - 1};
+        int shortest = bfsShortestPath(maze, {0, 0}, exit).size();
+        for (SearchMode mode : modes) {
+            Vector<GridLocation> path = shortestPath(maze, {0, 0}, exit, mode);
+            Grid<bool> grid = maze.toGrid();
+            EXPECT_NO_ERROR(validatePath(grid, toStack(path)));
+            EXPECT_EQUAL(path.size(), shortest);
+        }
+    }
+}
+
+STUDENT_TEST("Search modes on unreachable exit return empty path") {
+    Grid<bool> maze = {{true, true, false},
+                       {true, false, true},
+                       {false, true, true}};
+    Vector<SearchMode> modes = {SearchMode::BFS, SearchMode::AStar, SearchMode::Bidirectional, SearchMode::JumpPoint};
+    for (SearchMode mode : modes) {
+        SearchStats stats;
+        EXPECT(shortestPath(MazeBits(maze), {0, 0}, {2, 2}, mode, &stats).isEmpty());
+        EXPECT(stats.expanded > 0);
+        EXPECT_ERROR(solveMaze(maze, mode));
+    }
+}
+
+STUDENT_TEST("PathValidator agrees with validatePath") {
+    Grid<bool> grid = {{true, false},
+                       {true, true}};
+    MazeBits maze(grid);
+    PathValidator validator;
+    Vector<Vector<GridLocation>> invalid = {
+        {},
+        {{1, 0}, {0, 0}},
+        {{1, 0}, {1, 1}},
+        {{0, 0}, {0, 1}, {1, 1}},
+        {{0, 0}, {1, 1}},
+        {{0, 0}, {1, 0}, {0, 0}, {1, 0}, {1, 1}},
+        {{0, 0}, {1, 0}, {2, 0}, {1, 1}},
+    };
+    for (const Vector<GridLocation>& path : invalid) {
+        EXPECT(validator.check(maze, path.isEmpty() ? nullptr : &path[0], path.size()) != nullptr);
+    }
+    Vector<GridLocation> valid = {{0, 0}, {1, 0}, {1, 1}};
+    EXPECT_NO_ERROR(validator.validate(maze, &valid[0], valid.size()));
+    EXPECT_EQUAL(string(validator.check(maze, &invalid[5][0], invalid[5].size())), "Path has revisit");
+    // the failed checks must not leave stale marks behind
+    EXPECT(validator.check(maze, &valid[0], valid.size()) == nullptr);
+
+    for (const string& file : mazeFiles()) {
+        Grid<bool> g;
+        readMazeFile(file, g);
+        MazeBits bits(g);
+        Vector<GridLocation> path = bfsShortestPath(bits, {0, 0}, {g.numRows() - 1, g.numCols() - 1});
+        EXPECT(validator.check(bits, &path[0], path.size()) == nullptr);
+        path.add(path[path.size() - 2]);
+        EXPECT(validator.check(bits, &path[0], path.size()) != nullptr);
+    }
+}
+
+STUDENT_TEST("Time validatePath against PathValidator on many candidate paths") {
+    MazeBits maze = generateMaze(1001, 1001, 0.1);
+    Grid<bool> grid = maze.toGrid();
+    Vector<GridLocation> path = bfsShortestPath(maze, {0, 0}, {1000, 1000});
+    Stack<GridLocation> stack = toStack(path);
+    int rounds = 1000;
+
+    TIME_OPERATION(rounds * path.size(), validateRepeatedly(grid, stack, rounds));
+    TIME_OPERATION(rounds * path.size(), validateRepeatedly(maze, path, rounds));
+}
+
+STUDENT_TEST("Time solveMaze against solveMazeBFS on res mazes") {
+    for (const string& file : mazeFiles()) {
+        Grid<bool> maze;
+        readMazeFile(file, maze);
+        TIME_OPERATION(maze.numRows() * maze.numCols(), solveMaze(maze));
+        TIME_OPERATION(maze.numRows() * maze.numCols(), solveMazeBFS(maze));
+    }
+}
+
+STUDENT_TEST("Time solveMaze against bfsShortestPath on generated mazes up to 10k x 10k") {
+    Vector<int> sizes = {101, 301, 1001, 3001, 10001};
+    for (int size : sizes) {
+        MazeBits maze = generateMaze(size, size);
+        GridLocation exit = {size - 1, size - 1};
+        if (size <= 301) {   // solveMaze's Set operations make larger mazes impractical
+            Grid<bool> grid = maze.toGrid();
+            TIME_OPERATION(maze.numCells(), solveMaze(grid));
+        }
+        TIME_OPERATION(maze.numCells(), bfsShortestPath(maze, {0, 0}, exit));
+    }
+}
+
+STUDENT_TEST("Time each search mode, with expanded cells, checking equal path lengths") {
+    Vector<SearchMode> modes = {SearchMode::BFS, SearchMode::AStar, SearchMode::Bidirectional, SearchMode::JumpPoint};
+    Vector<string> names = {"BFS", "A*", "Bidirectional", "JPS"};
+    Vector<int> sizes = {101, 1001, 3001};
+    Vector<double> openFractions = {0, 0.3, 1};
+    for (int size : sizes) {
+        for (double open : openFractions) {
+            MazeBits maze = generateMaze(size, size, open);
+            // entry and exit close in Manhattan distance, in the middle of the maze
+            GridLocation entry = {size / 2 - size / 2 % 2, size / 2 - size / 2 % 2};
+            GridLocation exit = {entry.row + 10, entry.col + 10};
+            int bfsLength = -1;
+            for (int i = 0; i < modes.size(); i++) {
+                SearchStats stats;
+                Vector<GridLocation> path = shortestPath(maze, entry, exit, modes[i], &stats);
+                if (i == 0) {
+                    bfsLength = path.size();
+                }
+                EXPECT_EQUAL(path.size(), bfsLength);
+                cout << "    " << size << "x" << size << " open=" << open << " " << names[i]
+                     << ": length=" << path.size() << " expanded=" << stats.expanded
+                     << " secs=" << stats.seconds << endl;
+            }
+        }
+    }
+}
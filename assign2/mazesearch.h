@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vector>
+#include "grid.h"
+#include "gridlocation.h"
+#include "mazebits.h"
+#include "stack.h"
+#include "vector.h"
+
+/*
+ * FIFO queue of cell indices in a power-of-two ring buffer. It only allocates
+ * when it outgrows its capacity, so a search that reuses one queue does not
+ * allocate per step.
+ */
+class CellQueue {
+public:
+    CellQueue(int capacity = 64);
+
+    bool isEmpty() const { return head == tail; }
+    int size() const { return (int) (tail - head); }
+    void clear() { head = tail = 0; }
+
+    void enqueue(int cell) {
+        if (tail - head == buffer.size()) {
+            grow();
+        }
+        buffer[tail++ & mask] = cell;
+    }
+
+    int dequeue() {
+        return buffer[head++ & mask];
+    }
+
+private:
+    void grow();
+
+    std::vector<int> buffer;
+    unsigned mask;
+    unsigned head;
+    unsigned tail;
+};
+
+/*
+ * How shortestPath searches the maze. All modes return a shortest path.
+ *   BFS            breadth-first search outward from the entry
+ *   AStar          A* ordered by distance so far plus Manhattan distance to the exit
+ *   Bidirectional  breadth-first search from both ends, meeting in the middle
+ *   JumpPoint      jump point search, A* over the cells where a path must turn
+ */
+enum class SearchMode { BFS, AStar, Bidirectional, JumpPoint };
+
+/*
+ * Work done by one search: cells taken off the frontier and wall-clock time
+ */
+struct SearchStats {
+    long long expanded = 0;
+    double seconds = 0;
+};
+
+Vector<GridLocation> shortestPath(const MazeBits& maze, GridLocation entry, GridLocation exit,
+                                  SearchMode mode, SearchStats* stats = nullptr);
+
+Vector<GridLocation> bfsShortestPath(const MazeBits& maze, GridLocation entry, GridLocation exit);
+
+Stack<GridLocation> solveMaze(Grid<bool>& maze, SearchMode mode);
+
+Stack<GridLocation> solveMazeBFS(Grid<bool>& maze);
+
+Stack<GridLocation> toStack(const Vector<GridLocation>& path);
+
+/*
+ * Reusable validator for many candidate paths through mazes. It keeps a
+ * visited bitmap sized to the largest maze seen; each call marks only the
+ * cells on the path and unmarks them again before returning, so a check costs
+ * O(path length) no matter how large the maze is.
+ */
+class PathValidator {
+public:
+    const char* check(const MazeBits& maze, const GridLocation* path, int length,
+                      GridLocation entry, GridLocation exit);
+    const char* check(const MazeBits& maze, const GridLocation* path, int length);
+    void validate(const MazeBits& maze, const GridLocation* path, int length);
+
+private:
+    std::vector<uint8_t> visited;
+};
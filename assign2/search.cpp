@@ -152,6 +152,66 @@ Set<string> findQueryMatches(Map<string, Set<string>>& index, string query)
     return result;
 }
 
+/*
+ * Pages matching one query term. A term ending in '*' is a prefix search, which
+ * takes the union over every dictionary term starting with the rest of it; those
+ * terms have consecutive ordinals, found by prefixRange without decoding them.
+ */
+static Set<string> termMatches(const TermDictionary& terms, const Vector<Set<string>>& postings, string term) {
+    if (term.empty() || term[term.size() - 1] != '*') {
+        int ordinal = terms.lookup(term);
+        return ordinal < 0 ? Set<string>() : postings[ordinal];
+    }
+    int first, end;
+    terms.prefixRange(term.substr(0, term.size() - 1), first, end);
+    Set<string> result;
+    for (int ordinal = first; ordinal < end; ordinal++) {
+        result += postings[ordinal];
+    }
+    return result;
+}
+
+/*
+ * Same as findQueryMatches above, but any term may also be a prefix search such
+ * as 'fis*' or '+fis*', and the index is kept as the sorted term dictionary
+ * <terms> plus the pages of every term in <postings>, indexed by the term's
+ * ordinal (see postingsByOrdinal). Prefixes are expanded with the dictionary,
+ * so no scan over the whole index is needed.
+ */
+Set<string> findQueryMatches(const TermDictionary& terms, const Vector<Set<string>>& postings, string query)
+{
+    Set<string> result;
+    Vector<string> tokens = stringSplit(query, ' ');
+
+    for (const string& token : tokens) {
+        switch (token[0]) {
+        case '+':
+            result *= termMatches(terms, postings, toLowerCase(token.substr(1)));
+            break;
+        case '-':
+            result -= termMatches(terms, postings, toLowerCase(token.substr(1)));
+            break;
+        default:
+            result += termMatches(terms, postings, toLowerCase(token));
+            break;
+        }
+    }
+    return result;
+}
+
+/*
+ * The pages of every term of <index>, in sorted term order, so that entry i
+ * belongs to the term with ordinal i in TermDictionary(index.keys())
+ */
+Vector<Set<string>> postingsByOrdinal(const Map<string, Set<string>>& index)
+{
+    Vector<Set<string>> postings;
+    for (const string& term : index.keys()) {
+        postings.add(index.get(term));
+    }
+    return postings;
+}
+
 /*
  * A simple searchEngine, integrating all the functionality of the above implementation,
  * including reading database file, building indexes, and performing searches based on
@@ -2,6 +2,8 @@
 
 #include "map.h"
 #include "set.h"
+#include "termdict.h"
+#include "vector.h"
 #include <string>
 
 // Prototypes to be shared with other modules
@@ -14,4 +16,8 @@ int buildIndex(std::string dbfile, Map<std::string, Set<std::string>>& index);
 
 Set<std::string> findQueryMatches(Map<std::string, Set<std::string>>& index, std::string query);
 
+Set<std::string> findQueryMatches(const TermDictionary& terms, const Vector<Set<std::string>>& postings, std::string query);
+
+Vector<Set<std::string>> postingsByOrdinal(const Map<std::string, Set<std::string>>& index);
+
 void searchEngine(std::string dbfile);
@@ -0,0 +1,559 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <cctype>
+#include "error.h"
+#include "filelib.h"
+#include "map.h"
+#include "search.h"
+#include "searchserver.h"
+#include "set.h"
+#include "strlib.h"
+#include "vector.h"
+#include "testing/SimpleTest.h"
+using namespace std;
+using namespace std::chrono;
+
+
+/* * * * * * QueryCache * * * * * */
+
+QueryCache::QueryCache(int capacity) : capacity(capacity), numHits(0), numMisses(0) {
+    if (capacity < 0) {
+        error("QueryCache capacity must be non-negative");
+    }
+}
+
+/*
+ * Look up the ids cached for <query>, and mark the entry as most recently used
+ * @return true if the query was cached, in which case <ids> holds the result
+ */
+bool QueryCache::lookup(const string& query, Vector<int>& ids) {
+    lock_guard<mutex> guard(lock);
+    auto found = lookupTable.find(query);
+    if (found == lookupTable.end()) {
+        numMisses++;
+        return false;
+    }
+    // move the entry to the front without reallocating it
+    entries.splice(entries.begin(), entries, found->second);
+    ids = found->second->second;
+    numHits++;
+    return true;
+}
+
+/*
+ * Cache the ids of <query>, evicting the least recently used entry when full
+ */
+void QueryCache::insert(const string& query, const Vector<int>& ids) {
+    if (capacity == 0) {
+        return;
+    }
+    lock_guard<mutex> guard(lock);
+    auto found = lookupTable.find(query);
+    if (found != lookupTable.end()) {
+        // another thread answered the same query first, just refresh it
+        found->second->second = ids;
+        entries.splice(entries.begin(), entries, found->second);
+        return;
+    }
+    if ((int) entries.size() >= capacity) {
+        lookupTable.erase(entries.back().first);
+        entries.pop_back();
+    }
+    entries.emplace_front(query, ids);
+    lookupTable[query] = entries.begin();
+}
+
+int QueryCache::size() const {
+    lock_guard<mutex> guard(lock);
+    return entries.size();
+}
+
+long long QueryCache::hits() const {
+    return numHits;
+}
+
+long long QueryCache::misses() const {
+    return numMisses;
+}
+
+
+/* * * * * * LatencyHistogram * * * * * */
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+/*
+ * Map a latency to its bucket: the top 3 bits below the leading one select
+ * the sub-bucket inside the power of two
+ */
+int LatencyHistogram::bucketFor(long long nanos) {
+    if (nanos < kSubBuckets) {
+        return nanos < 0 ? 0 : nanos;
+    }
+    int log2 = 63 - __builtin_clzll(nanos);
+    int sub = (nanos >> (log2 - 3)) & (kSubBuckets - 1);
+    return (log2 - 2) * kSubBuckets + sub;
+}
+
+/*
+ * The largest latency that falls into <bucket>
+ */
+long long LatencyHistogram::upperBound(int bucket) {
+    if (bucket < kSubBuckets) {
+        return bucket;
+    }
+    int log2 = bucket / kSubBuckets + 2;
+    long long sub = bucket % kSubBuckets;
+    return ((kSubBuckets + sub + 1) << (log2 - 3)) - 1;
+}
+
+void LatencyHistogram::record(long long nanos) {
+    buckets[bucketFor(nanos)].fetch_add(1, memory_order_relaxed);
+}
+
+/*
+ * @param p The percentile, between 0 and 100
+ * @return The upper bound in nanoseconds of the bucket holding the p-th percentile,
+ *         or 0 if nothing has been recorded
+ */
+long long LatencyHistogram::percentile(double p) const {
+    long long total = count();
+    if (total == 0) {
+        return 0;
+    }
+    long long rank = (long long) (p / 100 * total + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > total) rank = total;
+
+    long long seen = 0;
+    for (int i = 0; i < kNumBuckets; i++) {
+        seen += buckets[i].load(memory_order_relaxed);
+        if (seen >= rank) {
+            return upperBound(i);
+        }
+    }
+    return upperBound(kNumBuckets - 1);
+}
+
+long long LatencyHistogram::count() const {
+    long long total = 0;
+    for (int i = 0; i < kNumBuckets; i++) {
+        total += buckets[i].load(memory_order_relaxed);
+    }
+    return total;
+}
+
+void LatencyHistogram::reset() {
+    for (int i = 0; i < kNumBuckets; i++) {
+        buckets[i].store(0, memory_order_relaxed);
+    }
+}
+
+string LatencyHistogram::toString() const {
+    ostringstream out;
+    out << "queries=" << count()
+        << " p50=" << percentile(50) / 1000.0 << "us"
+        << " p99=" << percentile(99) / 1000.0 << "us";
+    return out.str();
+}
+
+
+/* * * * * * SearchServer * * * * * */
+
+/*
+ * Build the shared index from <dbfile> and start <numThreads> workers
+ */
+SearchServer::SearchServer(string dbfile, int numThreads, int cacheCapacity)
+    : cache(cacheCapacity), stopping(false) {
+    if (numThreads < 1) {
+        error("SearchServer needs at least one worker thread");
+    }
+    {
+        // the Map is only needed to gather the index, and is freed here
+        Map<string, Set<string>> index;
+        buildIndex(dbfile, index);
+        terms = TermDictionary(index.keys());
+        postings = postingsByOrdinal(index);
+    }
+
+    // number every page once, so the cache stores small ids instead of links
+    Set<string> allLinks;
+    for (const Set<string>& pages : postings) {
+        allLinks += pages;
+    }
+    for (const string& link : allLinks) {
+        linkIds[link] = links.size();
+        links.add(link);
+    }
+
+    for (int i = 0; i < numThreads; i++) {
+        workers.emplace_back(&SearchServer::workerLoop, this);
+    }
+}
+
+SearchServer::~SearchServer() {
+    {
+        lock_guard<mutex> guard(taskLock);
+        stopping = true;
+    }
+    taskReady.notify_all();
+    for (thread& worker : workers) {
+        worker.join();
+    }
+}
+
+/*
+ * Each worker takes tasks off the shared queue until the server shuts down
+ */
+void SearchServer::workerLoop() {
+    while (true) {
+        function<void()> task;
+        {
+            unique_lock<mutex> guard(taskLock);
+            taskReady.wait(guard, [this] { return stopping || !tasks.empty(); });
+            if (tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
+
+void SearchServer::submit(function<void()> task) {
+    {
+        lock_guard<mutex> guard(taskLock);
+        tasks.push(std::move(task));
+    }
+    taskReady.notify_one();
+}
+
+/*
+ * Answer a normalized query from the cache, or from the index on a miss.
+ * The index is never written after construction, so concurrent readers are safe.
+ */
+Vector<int> SearchServer::lookupIds(const string& normalized) {
+    Vector<int> ids;
+    if (cache.lookup(normalized, ids)) {
+        return ids;
+    }
+    if (!normalized.empty()) {
+        for (const string& link : findQueryMatches(terms, postings, normalized)) {
+            ids.add(linkIds.get(link));
+        }
+    }
+    cache.insert(normalized, ids);
+    return ids;
+}
+
+Set<string> SearchServer::linksFor(const Vector<int>& ids) const {
+    Set<string> result;
+    for (int id : ids) {
+        result.add(links[id]);
+    }
+    return result;
+}
+
+/*
+ * Answer one query on the calling thread, with the same semantics as findQueryMatches
+ * with a term dictionary
+ */
+Set<string> SearchServer::query(string query) {
+    auto start = steady_clock::now();
+    Set<string> result = linksFor(lookupIds(normalizeQuery(query)));
+    latency.record(duration_cast<nanoseconds>(steady_clock::now() - start).count());
+    return result;
+}
+
+/*
+ * Answer many queries at once on the worker pool
+ * @return The result of each query, in the same order as <queries>
+ */
+Vector<Set<string>> SearchServer::queryBatch(const Vector<string>& queries) {
+    Vector<Set<string>> results(queries.size());
+    int remaining = queries.size();
+    mutex doneLock;
+    condition_variable allDone;
+
+    for (int i = 0; i < queries.size(); i++) {
+        submit([this, &queries, &results, &remaining, &doneLock, &allDone, i] {
+            results[i] = query(queries[i]);
+            lock_guard<mutex> guard(doneLock);
+            if (--remaining == 0) {
+                allDone.notify_one();
+            }
+        });
+    }
+
+    unique_lock<mutex> guard(doneLock);
+    allDone.wait(guard, [&remaining] { return remaining == 0; });
+    return results;
+}
+
+/*
+ * Batch mode: every line of <in> is a query, answered on the worker pool.
+ * Each answer is one line "<count> <link> <link> ...", written in input order.
+ * The line ":stats" writes the cache and latency statistics instead, taken
+ * once every query before it has been answered, and an empty line or end of
+ * input stops the server.
+ */
+void SearchServer::serve(istream& in, ostream& out) {
+    typedef shared_ptr<packaged_task<string()>> Job;
+    queue<future<string>> pending;
+    mutex pendingLock;
+    condition_variable pendingReady;
+    bool inputDone = false;
+
+    // answers finish out of order, so a single writer prints them in order;
+    // an empty future marks ":stats", which the writer only reaches once the
+    // answers to every earlier line are in
+    thread writer([&] {
+        while (true) {
+            future<string> answer;
+            {
+                unique_lock<mutex> guard(pendingLock);
+                pendingReady.wait(guard, [&] { return inputDone || !pending.empty(); });
+                if (pending.empty()) {
+                    return;
+                }
+                answer = std::move(pending.front());
+                pending.pop();
+            }
+            out << (answer.valid() ? answer.get() : stats()) << endl;
+        }
+    });
+
+    string line;
+    while (getline(in, line) && !line.empty()) {
+        if (line == ":stats") {
+            {
+                lock_guard<mutex> guard(pendingLock);
+                pending.push(future<string>());
+            }
+            pendingReady.notify_one();
+            continue;
+        }
+        Job job = make_shared<packaged_task<string()>>([this, line] {
+            Set<string> result = query(line);
+            ostringstream answer;
+            answer << result.size();
+            for (const string& link : result) {
+                answer << " " << link;
+            }
+            return answer.str();
+        });
+        {
+            lock_guard<mutex> guard(pendingLock);
+            pending.push(job->get_future());
+        }
+        pendingReady.notify_one();
+        submit([job] { (*job)(); });
+    }
+
+    {
+        lock_guard<mutex> guard(pendingLock);
+        inputDone = true;
+    }
+    pendingReady.notify_one();
+    writer.join();
+}
+
+int SearchServer::numPages() const {
+    return links.size();
+}
+
+int SearchServer::numThreads() const {
+    return workers.size();
+}
+
+string SearchServer::stats() const {
+    ostringstream out;
+    out << latency.toString()
+        << " cache-hits=" << cache.hits()
+        << " cache-misses=" << cache.misses()
+        << " cache-size=" << cache.size();
+    return out.str();
+}
+
+void SearchServer::resetStats() {
+    latency.reset();
+}
+
+
+/* * * * * * Clients * * * * * */
+
+/*
+ * Normalize a query so that equivalent spellings share a cache entry:
+ * terms are lower-cased and separated by exactly one space. Term order
+ * is kept because findQueryMatches applies terms from left to right.
+ */
+string normalizeQuery(string query) {
+    string result;
+    for (const string& token : stringSplit(query, ' ')) {
+        string term = trim(token);
+        if (term.empty()) {
+            continue;
+        }
+        if (!result.empty()) {
+            result += ' ';
+        }
+        result += toLowerCase(term);
+    }
+    return result;
+}
+
+/*
+ * Send every query in <queries> through the server's worker pool
+ * @return The throughput in queries per second
+ */
+double replayQueryLog(SearchServer& server, const Vector<string>& queries) {
+    auto start = steady_clock::now();
+    server.queryBatch(queries);
+    double seconds = duration<double>(steady_clock::now() - start).count();
+    return seconds > 0 ? queries.size() / seconds : 0;
+}
+
+/*
+ * Replay the query log against a fresh server (cold cache) with 1, 2, 4, ...
+ * up to <maxThreads> workers and report the throughput of each.
+ */
+void runLoadGenerator(string dbfile, string querylog, int maxThreads) {
+    ifstream in;
+    if (!openFile(in, querylog)) {
+        error("Open " + querylog + " error");
+    }
+    Vector<string> queries = readLines(in);
+
+    cout << "Replaying " << queries.size() << " queries from " << querylog << endl;
+    double baseline = 0;
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        SearchServer server(dbfile, threads);
+        double qps = replayQueryLog(server, queries);
+        if (threads == 1) {
+            baseline = qps;
+        }
+        cout << "  threads=" << threads
+             << " qps=" << qps
+             << " speedup=" << (baseline > 0 ? qps / baseline : 0)
+             << " " << server.stats() << endl;
+    }
+}
+
+/*
+ * Serve queries read from standard input until an empty line, see SearchServer::serve
+ */
+void searchServer(string dbfile, int numThreads) {
+    SearchServer server(dbfile, numThreads);
+    cout << "Serving " << server.numPages() << " pages on "
+         << server.numThreads() << " threads" << endl;
+    server.serve(cin, cout);
+}
+
+
+/* * * * * * Test Cases * * * * * */
+
+STUDENT_TEST("normalizeQuery lower-cases and collapses spaces but keeps term order") {
+    EXPECT_EQUAL(normalizeQuery("  Red   +FISH -blue "), "red +fish -blue");
+    EXPECT_EQUAL(normalizeQuery("fish red"), "fish red");
+    EXPECT_EQUAL(normalizeQuery("   "), "");
+}
+
+STUDENT_TEST("QueryCache evicts the least recently used query") {
+    QueryCache cache(2);
+    Vector<int> ids;
+    cache.insert("a", {1});
+    cache.insert("b", {2});
+    EXPECT(cache.lookup("a", ids));     // "b" is now least recently used
+    cache.insert("c", {3});
+    EXPECT(!cache.lookup("b", ids));
+    EXPECT(cache.lookup("c", ids));
+    EXPECT_EQUAL(ids, Vector<int>({3}));
+    EXPECT_EQUAL(cache.size(), 2);
+    EXPECT_EQUAL(cache.hits(), 2);
+    EXPECT_EQUAL(cache.misses(), 1);
+}
+
+STUDENT_TEST("LatencyHistogram percentiles are within one bucket") {
+    LatencyHistogram histogram;
+    for (int i = 1; i <= 1000; i++) {
+        histogram.record(i * 1000);
+    }
+    EXPECT_EQUAL(histogram.count(), 1000);
+    long long p50 = histogram.percentile(50);
+    long long p99 = histogram.percentile(99);
+    EXPECT(p50 >= 500000 && p50 <= 500000 * 9 / 8);
+    EXPECT(p99 >= 990000 && p99 <= 990000 * 9 / 8);
+}
+
+STUDENT_TEST("SearchServer answers match findQueryMatches, cached or not") {
+    Map<string, Set<string>> index;
+    buildIndex("res/tiny.txt", index);
+    SearchServer server("res/tiny.txt", 4);
+    Vector<string> queries = {"red", "red fish", "red +fish", "red -fish", "RED   +Fish", "hippo"};
+
+    for (int round = 0; round < 2; round++) {
+        Vector<Set<string>> results = server.queryBatch(queries);
+        for (int i = 0; i < queries.size(); i++) {
+            EXPECT_EQUAL(results[i], findQueryMatches(index, queries[i]));
+        }
+    }
+    EXPECT_EQUAL(server.query("fis* +r*"), findQueryMatches(index, "fish +red"));
+    EXPECT_EQUAL(server.numPages(), 4);
+}
+
+STUDENT_TEST("SearchServer batch mode writes answers in input order") {
+    SearchServer server("res/tiny.txt", 3);
+    istringstream in("red +fish\nhippo\nred fish\n\nignored\n");
+    ostringstream out;
+    server.serve(in, out);
+    Vector<string> lines = stringSplit(out.str(), '\n');
+    EXPECT_EQUAL(lines.size(), 3);
+    EXPECT_EQUAL(lines[0], "1 www.dr.seuss.net");
+    EXPECT_EQUAL(lines[1], "0");
+    EXPECT(startsWith(lines[2], "4 "));
+}
+
+STUDENT_TEST("SearchServer :stats counts every query before it") {
+    SearchServer server("res/tiny.txt", 4);
+    string input;
+    for (int i = 0; i < 200; i++) {
+        input += (i % 2 == 0 ? "red\n" : "fish -blue\n");
+    }
+    istringstream in(input + ":stats\n");
+    ostringstream out;
+    server.serve(in, out);
+    Vector<string> lines = stringSplit(out.str(), '\n');
+    EXPECT_EQUAL(lines.size(), 201);
+    EXPECT(startsWith(lines[200], "queries=200 "));
+    // two workers can both miss on the same query, but every query counts once
+    Map<string, int> fields;
+    for (const string& field : stringSplit(lines[200], ' ')) {
+        Vector<string> parts = stringSplit(field, '=');
+        if (startsWith(parts[0], "cache-")) {
+            fields[parts[0]] = stringToInteger(parts[1]);
+        }
+    }
+    EXPECT_EQUAL(fields["cache-hits"] + fields["cache-misses"], 200);
+}
+
+STUDENT_TEST("Time query log replay from 1 to 8 worker threads") {
+    Map<string, Set<string>> index;
+    buildIndex("res/website.txt", index);
+    Vector<string> terms = index.keys();
+    Vector<string> queries;
+    for (int i = 0; i < 20000; i++) {
+        string query = terms[randomInteger(0, terms.size() - 1)];
+        query += " +" + terms[randomInteger(0, terms.size() - 1)];
+        queries.add(query);
+    }
+    for (int threads = 1; threads <= 8; threads *= 2) {
+        SearchServer server("res/website.txt", threads, 0);   // no cache, measure the index
+        TIME_OPERATION(threads, replayQueryLog(server, queries));
+    }
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "map.h"
+#include "set.h"
+#include "termdict.h"
+#include "vector.h"
+
+/*
+ * Least-recently-used cache from a normalized query to the sorted ids of the
+ * pages that match it. Safe to share between threads.
+ */
+class QueryCache {
+public:
+    QueryCache(int capacity);
+
+    bool lookup(const std::string& query, Vector<int>& ids);
+    void insert(const std::string& query, const Vector<int>& ids);
+
+    int size() const;
+    long long hits() const;
+    long long misses() const;
+
+private:
+    typedef std::pair<std::string, Vector<int>> Entry;
+
+    int capacity;
+    std::list<Entry> entries;   // most recently used at the front
+    std::unordered_map<std::string, std::list<Entry>::iterator> lookupTable;
+    mutable std::mutex lock;
+    std::atomic<long long> numHits;
+    std::atomic<long long> numMisses;
+};
+
+/*
+ * Log-linear histogram of query latencies in nanoseconds. Every power of two
+ * is split into 8 linear sub-buckets, so any reported percentile is within
+ * 12.5% of the true value. Recording is lock-free.
+ */
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    void record(long long nanos);
+    long long percentile(double p) const;
+    long long count() const;
+    void reset();
+    std::string toString() const;
+
+private:
+    static const int kSubBuckets = 8;
+    static const int kNumBuckets = 64 * kSubBuckets;
+
+    static int bucketFor(long long nanos);
+    static long long upperBound(int bucket);
+
+    std::atomic<long long> buckets[kNumBuckets];
+};
+
+/*
+ * Concurrent query server over a read-only index built once from dbfile.
+ * The index keeps its terms only in a front-coded TermDictionary and the pages
+ * of each term by the term's ordinal, so no Map of terms outlives the build.
+ * Queries may use prefix terms such as 'fis*'. Queries are answered on a
+ * fixed pool of worker threads, results are cached by normalized query and
+ * every answered query is timed.
+ */
+class SearchServer {
+public:
+    SearchServer(std::string dbfile, int numThreads, int cacheCapacity = 1024);
+    ~SearchServer();
+
+    Set<std::string> query(std::string query);
+    Vector<Set<std::string>> queryBatch(const Vector<std::string>& queries);
+    void serve(std::istream& in, std::ostream& out);
+
+    int numPages() const;
+    int numThreads() const;
+    std::string stats() const;
+    void resetStats();
+
+private:
+    Vector<int> lookupIds(const std::string& normalized);
+    Set<std::string> linksFor(const Vector<int>& ids) const;
+    void submit(std::function<void()> task);
+    void workerLoop();
+
+    TermDictionary terms;
+    Vector<Set<std::string>> postings;  // pages of each term, by ordinal in terms
+    Map<std::string, int> linkIds;
+    Vector<std::string> links;      // id to link, ids assigned in sorted link order
+    QueryCache cache;
+    LatencyHistogram latency;
+
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex taskLock;
+    std::condition_variable taskReady;
+    bool stopping;
+};
+
+std::string normalizeQuery(std::string query);
+
+double replayQueryLog(SearchServer& server, const Vector<std::string>& queries);
+
+void runLoadGenerator(std::string dbfile, std::string querylog, int maxThreads);
+
+void searchServer(std::string dbfile, int numThreads);
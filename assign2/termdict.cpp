@@ -0,0 +1,364 @@
+#include <iostream>
+#include <string>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+#include "error.h"
+#include "map.h"
+#include "search.h"
+#include "set.h"
+#include "termdict.h"
+#include "vector.h"
+#include "testing/SimpleTest.h"
+using namespace std;
+
+/*
+ * Append <value> to <out> using 7 bits per byte, high bit set on all but the last byte
+ */
+static void writeVarint(string& out, int value) {
+    while (value >= 0x80) {
+        out += (char) ((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += (char) value;
+}
+
+/*
+ * Read a value written by writeVarint starting at <pos>, and advance <pos> past it
+ */
+static int readVarint(const string& in, int& pos) {
+    int value = 0;
+    int shift = 0;
+    unsigned char byte;
+    do {
+        byte = in[pos++];
+        value |= (byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+/*
+ * Decode the next term of a block into <term>, which must hold the previous
+ * term of the same block (or anything, for the first term of a block)
+ */
+static void readTerm(const string& in, int& pos, bool isHead, string& term) {
+    int shared = isHead ? 0 : readVarint(in, pos);
+    int suffix = readVarint(in, pos);
+    term.resize(shared);
+    term.append(in, pos, suffix);
+    pos += suffix;
+}
+
+TermDictionary::TermDictionary() : numTerms(0) {
+}
+
+/*
+ * @param sortedTerms Distinct terms in increasing order, such as index.keys()
+ */
+TermDictionary::TermDictionary(const Vector<string>& sortedTerms) : numTerms(sortedTerms.size()) {
+    string prev;
+    for (int i = 0; i < sortedTerms.size(); i++) {
+        const string& cur = sortedTerms[i];
+        if (i > 0 && cur <= prev) {
+            error("TermDictionary terms must be distinct and sorted");
+        }
+        if (i % kBlockSize == 0) {
+            blockOffsets.add(data.size());
+            writeVarint(data, cur.size());
+            data += cur;
+        } else {
+            int shared = 0;
+            while (shared < (int) prev.size() && shared < (int) cur.size() && prev[shared] == cur[shared]) {
+                shared++;
+            }
+            writeVarint(data, shared);
+            writeVarint(data, cur.size() - shared);
+            data.append(cur, shared, string::npos);
+        }
+        prev = cur;
+    }
+    data.shrink_to_fit();
+}
+
+int TermDictionary::size() const {
+    return numTerms;
+}
+
+/*
+ * Compare the first term of <block> against <term> in place, without decoding it
+ * @return Negative, zero or positive like string::compare
+ */
+int TermDictionary::compareHead(int block, const string& term) const {
+    int pos = blockOffsets[block];
+    int length = readVarint(data, pos);
+    return data.compare(pos, length, term);
+}
+
+/*
+ * Binary search for the last block whose first term is <= <term>, or 0 if none is
+ */
+int TermDictionary::findBlock(const string& term) const {
+    int lo = 0;
+    int hi = blockOffsets.size() - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (compareHead(mid, term) <= 0) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+/*
+ * Scan the block that could hold <term> for the first term >= <term>
+ * @param found Set to that term when it exists
+ * @return Its ordinal, or size() if there is none
+ */
+int TermDictionary::scanBlock(const string& term, string& found) const {
+    if (numTerms == 0) {
+        return 0;
+    }
+    int block = findBlock(term);
+    int pos = blockOffsets[block];
+    for (int ordinal = block * kBlockSize; ordinal < numTerms && ordinal < (block + 1) * kBlockSize; ordinal++) {
+        readTerm(data, pos, ordinal == block * kBlockSize, found);
+        if (found >= term) {
+            return ordinal;
+        }
+    }
+    // every term of the block is smaller, so the next block head is the answer
+    int next = min(numTerms, (block + 1) * kBlockSize);
+    if (next < numTerms) {
+        pos = blockOffsets[block + 1];
+        readTerm(data, pos, true, found);
+    }
+    return next;
+}
+
+/*
+ * @return The ordinal of the first term >= <term>, or size() if there is none
+ */
+int TermDictionary::lowerBound(const string& term) const {
+    string found;
+    return scanBlock(term, found);
+}
+
+/*
+ * @return The ordinal of <term>, or -1 if it is not in the dictionary
+ */
+int TermDictionary::lookup(const string& term) const {
+    string found;
+    int ordinal = scanBlock(term, found);
+    if (ordinal < numTerms && found == term) {
+        return ordinal;
+    }
+    return -1;
+}
+
+/*
+ * @return The term with the given ordinal
+ */
+string TermDictionary::term(int ordinal) const {
+    if (ordinal < 0 || ordinal >= numTerms) {
+        error("TermDictionary ordinal out of range");
+    }
+    int block = ordinal / kBlockSize;
+    int pos = blockOffsets[block];
+    string cur;
+    for (int i = block * kBlockSize; i <= ordinal; i++) {
+        readTerm(data, pos, i == block * kBlockSize, cur);
+    }
+    return cur;
+}
+
+/*
+ * @return All terms starting with <prefix>, in sorted order
+ */
+Vector<string> TermDictionary::withPrefix(const string& prefix) const {
+    Vector<string> result;
+    int first = lowerBound(prefix);
+    if (first >= numTerms) {
+        return result;
+    }
+
+    // decode forward from the start of the block, skipping terms before <first>
+    int block = first / kBlockSize;
+    int pos = blockOffsets[block];
+    string cur;
+    for (int ordinal = block * kBlockSize; ordinal < numTerms; ordinal++) {
+        readTerm(data, pos, ordinal % kBlockSize == 0, cur);
+        if (ordinal < first) {
+            continue;
+        }
+        if (cur.compare(0, prefix.size(), prefix) != 0) {
+            break;
+        }
+        result.add(cur);
+    }
+    return result;
+}
+
+/*
+ * The ordinals of the terms starting with <prefix>, without decoding them: they
+ * end where the terms reach the smallest string greater than every such term,
+ * the prefix with its last byte below 0xff incremented and the rest dropped.
+ * @param first Set to the ordinal of the first term starting with <prefix>
+ * @param end Set to the ordinal one past the last, so the range is [first, end)
+ */
+void TermDictionary::prefixRange(const string& prefix, int& first, int& end) const {
+    first = lowerBound(prefix);
+    string bound = prefix;
+    while (!bound.empty() && (unsigned char) bound.back() == 0xff) {
+        bound.pop_back();
+    }
+    if (bound.empty()) {
+        end = numTerms;
+        return;
+    }
+    bound.back()++;
+    end = lowerBound(bound);
+}
+
+/*
+ * @return Bytes of heap and object storage used by the dictionary
+ */
+long long TermDictionary::memoryUsage() const {
+    return sizeof(*this) + data.capacity() + (long long) blockOffsets.size() * sizeof(int);
+}
+
+
+/* * * * * * Test Cases * * * * * */
+
+/* Test helper to count how many of <terms> the dictionary contains */
+static int countFound(const TermDictionary& dict, const Vector<string>& terms) {
+    int found = 0;
+    for (const string& term : terms) {
+        found += dict.lookup(term) >= 0;
+    }
+    return found;
+}
+
+/* Test helper to count how many of <terms> the index contains */
+static int countFound(Map<string, Set<string>>& index, const Vector<string>& terms) {
+    int found = 0;
+    for (const string& term : terms) {
+        found += index.containsKey(term);
+    }
+    return found;
+}
+
+STUDENT_TEST("TermDictionary exact lookup and ordinal to term") {
+    Vector<string> terms = {"blue", "eat", "fish", "fishing", "fishy", "green", "i", "milk", "one", "red", "two"};
+    TermDictionary dict(terms);
+    EXPECT_EQUAL(dict.size(), terms.size());
+    for (int i = 0; i < terms.size(); i++) {
+        EXPECT_EQUAL(dict.lookup(terms[i]), i);
+        EXPECT_EQUAL(dict.term(i), terms[i]);
+    }
+    EXPECT_EQUAL(dict.lookup("fis"), -1);
+    EXPECT_EQUAL(dict.lookup("zebra"), -1);
+    EXPECT_EQUAL(dict.lookup(""), -1);
+    EXPECT_ERROR(dict.term(terms.size()));
+}
+
+STUDENT_TEST("TermDictionary prefix enumeration across block boundaries") {
+    Vector<string> terms;
+    for (char c = 'a'; c <= 'z'; c++) {
+        terms.add(string("pre") + c);
+        terms.add(string("pre") + c + "fix");
+    }
+    terms.add("zzz");
+    TermDictionary dict(terms);
+    EXPECT_EQUAL(dict.withPrefix("pre").size(), 52);
+    Vector<string> expected = {"prem", "premfix"};
+    EXPECT_EQUAL(dict.withPrefix("prem"), expected);
+    EXPECT(dict.withPrefix("q").isEmpty());
+    EXPECT_EQUAL(dict.withPrefix(""), terms);
+    EXPECT_EQUAL(dict.lowerBound("a"), 0);
+    EXPECT_EQUAL(dict.lowerBound("zzzz"), terms.size());
+}
+
+STUDENT_TEST("TermDictionary prefixRange agrees with withPrefix") {
+    Vector<string> terms;
+    for (char c = 'a'; c <= 'z'; c++) {
+        terms.add(string("pre") + c);
+        terms.add(string("pre") + c + "fix");
+    }
+    terms.add("zzz");
+    terms.add("zzz\xff");
+    terms.add("zzz\xff\xff");
+    TermDictionary dict(terms);
+    Vector<string> prefixes = {"", "p", "pre", "prem", "premfix", "premfixx", "q", "a", "zzz", "zzz\xff", "\xff"};
+    for (const string& prefix : prefixes) {
+        int first, end;
+        dict.prefixRange(prefix, first, end);
+        Vector<string> matches = dict.withPrefix(prefix);
+        EXPECT_EQUAL(end - first, matches.size());
+        if (!matches.isEmpty()) {
+            EXPECT_EQUAL(dict.term(first), matches[0]);
+        }
+    }
+}
+
+STUDENT_TEST("TermDictionary rejects unsorted terms") {
+    Vector<string> terms = {"red", "fish"};
+    EXPECT_ERROR(TermDictionary(terms));
+}
+
+STUDENT_TEST("findQueryMatches with prefix terms") {
+    Map<string, Set<string>> index;
+    buildIndex("res/tiny.txt", index);
+    TermDictionary dict(index.keys());
+    Vector<Set<string>> postings = postingsByOrdinal(index);
+    EXPECT_EQUAL(findQueryMatches(dict, postings, "fis*"), findQueryMatches(index, "fish"));
+    EXPECT_EQUAL(findQueryMatches(dict, postings, "r* +f*"), findQueryMatches(index, "red +fish"));
+    EXPECT_EQUAL(findQueryMatches(dict, postings, "red -fi*"), findQueryMatches(index, "red -fish"));
+    EXPECT(findQueryMatches(dict, postings, "hipp*").isEmpty());
+    EXPECT(findQueryMatches(dict, postings, "hippo").isEmpty());
+    EXPECT_EQUAL(findQueryMatches(dict, postings, "red fish"), findQueryMatches(index, "red fish"));
+}
+
+/*
+ * @return Bytes of heap currently allocated, or -1 where the C library
+ *         cannot tell (anything but glibc 2.33 or later)
+ */
+static long long heapInUse() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    return mallinfo2().uordblks;
+#else
+    return -1;
+#endif
+}
+
+STUDENT_TEST("Time TermDictionary lookup against Map, report bytes per term") {
+    Map<string, Set<string>> index;
+    buildIndex("res/website.txt", index);
+    Vector<string> terms = index.keys();
+    TermDictionary dict(terms);
+
+    // the heap a Map of the same terms to empty sets takes, as glibc counts it
+    long long mapBytes = -1;
+    {
+        Map<string, Set<string>> keysOnly;
+        long long before = heapInUse();
+        for (const string& term : terms) {
+            keysOnly[term];
+        }
+        if (before >= 0) {
+            mapBytes = heapInUse() - before;
+        }
+    }
+    cout << "    terms=" << terms.size()
+         << " dictionary bytes/term=" << (double) dict.memoryUsage() / terms.size();
+    if (mapBytes >= 0) {
+        cout << " Map keys bytes/term=" << (double) mapBytes / terms.size();
+    }
+    cout << endl;
+
+    TIME_OPERATION(terms.size(), countFound(dict, terms));
+    TIME_OPERATION(terms.size(), countFound(index, terms));
+    EXPECT_EQUAL(countFound(dict, terms), terms.size());
+}
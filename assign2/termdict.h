@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include "vector.h"
+
+/*
+ * Compact, immutable dictionary of sorted terms.
+ *
+ * Terms are front coded in blocks of kBlockSize: the first term of a block is
+ * stored whole and every other term only as the length of the prefix it shares
+ * with the previous term plus the remaining suffix. Ordinals are the positions
+ * of the terms in sorted order, so a prefix matches a contiguous ordinal range.
+ */
+class TermDictionary {
+public:
+    TermDictionary();
+    TermDictionary(const Vector<std::string>& sortedTerms);
+
+    int size() const;
+    int lookup(const std::string& term) const;
+    int lowerBound(const std::string& term) const;
+    std::string term(int ordinal) const;
+    Vector<std::string> withPrefix(const std::string& prefix) const;
+    void prefixRange(const std::string& prefix, int& first, int& end) const;
+    long long memoryUsage() const;
+
+private:
+    static const int kBlockSize = 16;
+
+    int findBlock(const std::string& term) const;
+    int scanBlock(const std::string& term, std::string& found) const;
+    int compareHead(int block, const std::string& term) const;
+
+    std::string data;               // all encoded blocks, back to back
+    Vector<int> blockOffsets;       // where each block begins in data
+    int numTerms;
+};
@@ -9,6 +9,15 @@ int scoreBoard(Grid<char>& board, Lexicon& lex);
 void findWords(Grid<char>& board, Lexicon& lex, Set<string>& foundWords,
                Grid<bool>& visited, int row, int col, string& soFar);
 
+/* Needed for backtrackingwarmup.cpp */
+#include <cstdint>
+#include "vector.h"
+
+int countZeroSumSubsets(Vector<int> &v, int index, int sumSoFar);
+uint64_t countZeroSumSubsetsMITM(const Vector<int>& v);
+uint64_t countZeroSumSubsetsDP(const Vector<int>& v);
+uint64_t countZeroSumSubsetsFast(const Vector<int>& v);
+
 /* Needed for voting.cpp */
 #include "vector.h"
 
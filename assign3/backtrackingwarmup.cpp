@@ -8,6 +8,12 @@
 
 #include <iostream>    // for cout, endl
 #include <string>      // for string class
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "backtracking.h"
+#include "error.h"
+#include "random.h"
 #include "simpio.h"    // for getLine
 #include "hanoigui.h"
 #include "testing/SimpleTest.h"
@@ -28,6 +34,257 @@ int countZeroSumSubsets(Vector<int> &v, int index, int sumSoFar) {
     }
 }
 
+/*
+ * The sums of all 2^size subsets of v[start, start + size), sorted. Each
+ * element doubles the list: the sums without it are already sorted, adding
+ * it to all of them keeps them sorted, and merging the two halves keeps the
+ * whole list sorted, so no sort is needed and the work is O(2^size).
+ */
+static vector<long long> sortedSubsetSums(const Vector<int>& v, int start, int size) {
+    vector<long long> sums = {0};
+    vector<long long> merged;
+    vector<long long> shifted;
+    for (int i = start; i < start + size; i++) {
+        shifted.resize(sums.size());
+        for (size_t j = 0; j < sums.size(); j++) {
+            shifted[j] = sums[j] + v[i];
+        }
+        merged.resize(2 * sums.size());
+        merge(sums.begin(), sums.end(), shifted.begin(), shifted.end(), merged.begin());
+        sums.swap(merged);
+    }
+    return sums;
+}
+
+/*
+ * All the sums a + b of an element of <first> and one of <second>, both
+ * sorted, produced one at a time in increasing order. A min-heap holds the
+ * next candidate for every element of first, so the stream needs memory for
+ * first.size() entries, not for all first.size() * second.size() sums.
+ */
+class PairSumStream {
+public:
+    PairSumStream(vector<long long> first, vector<long long> second)
+        : first(std::move(first)), second(std::move(second)) {
+        for (int i = 0; i < (int) this->first.size(); i++) {
+            heap.push_back({this->first[i] + this->second[0], i, 0});
+        }
+        for (int i = heap.size() / 2 - 1; i >= 0; i--) {
+            siftDown(i);
+        }
+    }
+
+    bool done() const { return heap.empty(); }
+    long long peek() const { return heap[0].sum; }
+
+    /*
+     * Drop every sum equal to the smallest one. Each step replaces the top
+     * entry by its next sum, or by the last entry once its row is used up,
+     * and sifts it down: one pass down the heap instead of a pop and a push.
+     *
+     * @return How many there were
+     */
+    uint64_t skipRun() {
+        long long value = peek();
+        uint64_t run = 0;
+        while (!heap.empty() && heap[0].sum == value) {
+            Entry& top = heap[0];
+            if (++top.j < (int) second.size()) {
+                top.sum = first[top.i] + second[top.j];
+            } else {
+                top = heap.back();
+                heap.pop_back();
+            }
+            siftDown(0);
+            run++;
+        }
+        return run;
+    }
+
+private:
+    struct Entry {
+        long long sum;
+        int i;      // the sum is first[i] + second[j]
+        int j;
+    };
+
+    void siftDown(size_t index) {
+        Entry moving = heap[index];
+        while (true) {
+            size_t child = 2 * index + 1;
+            if (child >= heap.size()) {
+                break;
+            }
+            if (child + 1 < heap.size() && heap[child + 1].sum < heap[child].sum) {
+                child++;
+            }
+            if (heap[child].sum >= moving.sum) {
+                break;
+            }
+            heap[index] = heap[child];
+            index = child;
+        }
+        heap[index] = moving;
+    }
+
+    vector<long long> first;
+    vector<long long> second;
+    vector<Entry> heap;
+};
+
+/*
+ * @return The elements of <sums> negated, still in increasing order
+ */
+static vector<long long> negated(const vector<long long>& sums) {
+    vector<long long> result(sums.rbegin(), sums.rend());
+    for (long long& sum : result) {
+        sum = -sum;
+    }
+    return result;
+}
+
+// up to this many elements, meet in the middle keeps both halves' sums
+static const int kWholeHalvesLimit = 44;
+
+/*
+ * Meet in the middle: list the sorted subset sums of each half of <v>, then
+ * walk the first list up and the second one down, counting the pairs that
+ * add up to zero (runs of equal sums multiply). O(2^(n/2)) time instead of
+ * O(2^n). Counts include the empty subset, as in countZeroSumSubsets, and are
+ * modulo 2^64.
+ *
+ * Holding the halves takes O(2^(n/2)) memory: each list is 32 MB at 44
+ * elements, about three times that while it is built, but would be 8 GB at
+ * 60. So past kWholeHalvesLimit elements the lists are never built
+ * (Schroeppel and Shamir): each half is split again into quarters with sorted
+ * sums A, B and C, D, and PairSumStreams produce the sums a + b in increasing
+ * order and -(c + d) in increasing order as well, so the same walk runs over
+ * the streams. That needs O(2^(n/4)) memory, about 2 MB at 60 elements, for
+ * an extra log factor of heap work in the O(2^(n/2)) time: a few minutes at
+ * 60 elements.
+ */
+uint64_t countZeroSumSubsetsMITM(const Vector<int>& v) {
+    int n = v.size();
+    if (n > 60) {
+        error("countZeroSumSubsetsMITM supports at most 60 elements");
+    }
+    int half = n / 2;
+    uint64_t count = 0;
+    if (n <= kWholeHalvesLimit) {
+        vector<long long> left = sortedSubsetSums(v, 0, half);
+        vector<long long> right = sortedSubsetSums(v, half, n - half);
+        size_t i = 0;
+        long long j = right.size() - 1;
+        while (i < left.size() && j >= 0) {
+            long long sum = left[i] + right[j];
+            if (sum < 0) {
+                i++;
+            } else if (sum > 0) {
+                j--;
+            } else {
+                uint64_t leftRun = 0, rightRun = 0;
+                long long value = left[i];
+                for (; i < left.size() && left[i] == value; i++) {
+                    leftRun++;
+                }
+                value = right[j];
+                for (; j >= 0 && right[j] == value; j--) {
+                    rightRun++;
+                }
+                count += leftRun * rightRun;
+            }
+        }
+        return count;
+    }
+
+    int quarter = half / 2;
+    int threeQuarters = half + (n - half) / 2;
+    PairSumStream left(sortedSubsetSums(v, 0, quarter), sortedSubsetSums(v, quarter, half - quarter));
+    PairSumStream right(negated(sortedSubsetSums(v, half, threeQuarters - half)),
+                        negated(sortedSubsetSums(v, threeQuarters, n - threeQuarters)));
+    while (!left.done() && !right.done()) {
+        if (left.peek() < right.peek()) {
+            left.skipRun();
+        } else if (left.peek() > right.peek()) {
+            right.skipRun();
+        } else {
+            count += left.skipRun() * right.skipRun();
+        }
+    }
+    return count;
+}
+
+// the DP's table holds at most this many sums, 128 MB of counts
+static const long long kMaxDPSums = 1LL << 24;
+
+/*
+ * Pseudo-polynomial subset-sum DP: ways[s] counts the subsets of the
+ * elements so far with sum s, over the range of sums they can reach. Each
+ * element updates the range in place, in the direction that never reuses it.
+ * O(n * R) time and O(R) memory for R the spread between the most negative
+ * and most positive possible sums, whatever n is. Counts are modulo 2^64.
+ */
+uint64_t countZeroSumSubsetsDP(const Vector<int>& v) {
+    long long lowest = 0, highest = 0;
+    for (int x : v) {
+        (x < 0 ? lowest : highest) += x;
+    }
+    if (highest - lowest >= kMaxDPSums) {
+        error("countZeroSumSubsetsDP needs the possible sums to span at most 2^24 values");
+    }
+    vector<uint64_t> ways(highest - lowest + 1, 0);
+    long long offset = -lowest;
+    ways[offset] = 1;
+    long long low = 0, high = 0;        // the range of sums reached so far
+    for (int x : v) {
+        if (x > 0) {
+            for (long long s = high; s >= low; s--) {
+                ways[s + x + offset] += ways[s + offset];
+            }
+            high += x;
+        } else if (x < 0) {
+            for (long long s = low; s <= high; s++) {
+                ways[s + x + offset] += ways[s + offset];
+            }
+            low += x;
+        } else {
+            for (long long s = low; s <= high; s++) {
+                ways[s + offset] *= 2;
+            }
+        }
+    }
+    return ways[offset];
+}
+
+/*
+ * Counts zero-sum subsets with whichever engine costs less for <v>: the DP
+ * takes about n * R steps for a spread R of possible sums, meet in the middle
+ * about n/2 * 2^(n/2), times another n/4 for the heaps past 44 elements, so
+ * small values favor the DP even for hundreds of elements and wide values
+ * favor meet in the middle up to 60 elements. Errors when <v> has more than
+ * 60 elements and too wide a spread for the DP's table.
+ */
+uint64_t countZeroSumSubsetsFast(const Vector<int>& v) {
+    long long lowest = 0, highest = 0;
+    for (int x : v) {
+        (x < 0 ? lowest : highest) += x;
+    }
+    double dpCost = (double) v.size() * (highest - lowest + 1);
+    double mitmCost = (v.size() / 2 + 1) * pow(2.0, v.size() - v.size() / 2);
+    if (v.size() > kWholeHalvesLimit) {
+        mitmCost *= v.size() / 4;
+    }
+    bool dpFits = highest - lowest < kMaxDPSums;
+    if (!dpFits && v.size() > 60) {
+        error("countZeroSumSubsetsFast needs at most 60 elements, "
+              "or possible sums spanning at most 2^24 values");
+    }
+    if (dpFits && (dpCost <= mitmCost || v.size() > 60)) {
+        return countZeroSumSubsetsDP(v);
+    }
+    return countZeroSumSubsetsMITM(v);
+}
+
 /*
  * This function is only one character different than the
  * correct version above, but even a small edit can cause big havoc
@@ -104,3 +361,90 @@ STUDENT_TEST("Trigger the bug in the buggyCount program with the smallest input"
     Vector<int> nums = {1};
     EXPECT_EQUAL(countZeroSumSubsets(nums, 0, 0), buggyCount(nums, 0, 0));
 }
+
+STUDENT_TEST("countZeroSumSubsets engines agree with the recursion") {
+    for (int trial = 0; trial < 300; trial++) {
+        Vector<int> nums;
+        int size = randomInteger(0, 16);
+        int range = randomChance(0.5) ? 3 : 1000;
+        for (int i = 0; i < size; i++) {
+            nums.add(randomInteger(-range, range));
+        }
+        uint64_t expected = countZeroSumSubsets(nums, 0, 0);
+        EXPECT_EQUAL(countZeroSumSubsetsMITM(nums), expected);
+        EXPECT_EQUAL(countZeroSumSubsetsDP(nums), expected);
+        EXPECT_EQUAL(countZeroSumSubsetsFast(nums), expected);
+    }
+    Vector<int> zeros(20, 0);
+    EXPECT_EQUAL(countZeroSumSubsetsFast(zeros), 1 << 20);
+}
+
+STUDENT_TEST("countZeroSumSubsets engines on 40 to 200 elements") {
+    // 30 ones and 30 minus ones: choose k of each, C(60, 30) ways in all
+    Vector<int> ones;
+    for (int i = 0; i < 30; i++) {
+        ones.add(1);
+        ones.add(-1);
+    }
+    EXPECT_EQUAL(countZeroSumSubsetsDP(ones), 118264581564861424ULL);
+    EXPECT_EQUAL(countZeroSumSubsetsFast(ones), 118264581564861424ULL);
+
+    Vector<int> wide;
+    for (int i = 0; i < 40; i++) {
+        wide.add(randomInteger(-1000, 1000));
+    }
+    EXPECT_EQUAL(countZeroSumSubsetsMITM(wide), countZeroSumSubsetsDP(wide));
+
+    // past 44 elements meet in the middle streams the half sums from quarters
+    for (int size : {45, 48}) {
+        for (int range : {3, 1000}) {
+            Vector<int> nums;
+            for (int i = 0; i < size; i++) {
+                nums.add(randomInteger(-range, range));
+            }
+            EXPECT_EQUAL(countZeroSumSubsetsMITM(nums), countZeroSumSubsetsDP(nums));
+        }
+    }
+
+    Vector<int> many;
+    for (int i = 0; i < 200; i++) {
+        many.add(randomInteger(-5, 5));
+    }
+    EXPECT_EQUAL(countZeroSumSubsetsFast(many), countZeroSumSubsetsDP(many));
+    EXPECT_ERROR(countZeroSumSubsetsMITM(many));
+
+    // too many elements for meet in the middle, too wide for the DP's table
+    Vector<int> huge;
+    for (int i = 0; i < 200; i++) {
+        huge.add(randomInteger(-1000000, 1000000));
+    }
+    EXPECT_ERROR(countZeroSumSubsetsDP(huge));
+    EXPECT_ERROR(countZeroSumSubsetsFast(huge));
+}
+
+STUDENT_TEST("Time countZeroSumSubsets: recursion, meet in the middle and DP") {
+    for (int size = 16; size <= 24; size += 4) {
+        Vector<int> nums;
+        for (int i = 0; i < size; i++) {
+            nums.add(randomInteger(-1000000, 1000000));
+        }
+        TIME_OPERATION(size, countZeroSumSubsets(nums, 0, 0));
+        TIME_OPERATION(size, countZeroSumSubsetsFast(nums));
+    }
+    // whole halves up to 44 elements, quarters and heaps beyond
+    for (int size = 30; size <= 54; size += 4) {
+        Vector<int> nums;
+        for (int i = 0; i < size; i++) {
+            nums.add(randomInteger(-1000000, 1000000));
+        }
+        TIME_OPERATION(size, countZeroSumSubsetsMITM(nums));
+    }
+    for (int size = 60; size <= 240; size *= 2) {
+        Vector<int> nums;
+        for (int i = 0; i < size; i++) {
+            nums.add(randomInteger(-100, 100));
+        }
+        TIME_OPERATION(size, countZeroSumSubsetsDP(nums));
+        TIME_OPERATION(size, countZeroSumSubsetsFast(nums));
+    }
+}
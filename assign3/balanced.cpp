@@ -6,8 +6,18 @@
  */
 #include <iostream>    // for cout, endl
 #include <string>      // for string class
+#include <array>
+#include <chrono>
 #include <regex>
+#include <sstream>
 #include <stack>
+#include <thread>
+#include <vector>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BRACKETS_AVX2 1 // the AVX2 scan is compiled in, and used if the CPU has AVX2
+#include <immintrin.h>
+#endif
+#include "random.h"
 #include "recursion.h"
 #include "testing/SimpleTest.h"
 
@@ -101,6 +111,272 @@ bool isBalanced(string str) {
 }
 
 
+/*
+ * Byte classes for BracketChecker: 0 for anything that is not a bracket, 1-3
+ * for the open brackets ( [ { and the negatives for the matching closers
+ */
+static array<int8_t, 256> makeBracketKinds() {
+    array<int8_t, 256> kinds = {};
+    kinds['('] = 1;
+    kinds['['] = 2;
+    kinds['{'] = 3;
+    kinds[')'] = -1;
+    kinds[']'] = -2;
+    kinds['}'] = -3;
+    return kinds;
+}
+
+static const array<int8_t, 256> kBracketKinds = makeBracketKinds();
+
+/*
+ * @return Whether forEachBracket scans 32 bytes at a time with AVX2 on this CPU
+ */
+static bool bracketScanUsesAvx2() {
+#if defined(BRACKETS_AVX2)
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+#if defined(BRACKETS_AVX2)
+/*
+ * The AVX2 part of forEachBracket: compare 32 bytes at a time against the six
+ * brackets and call fn only for the bytes that matched, so runs of ordinary
+ * text cost a few instructions per 32 bytes. Stops short of the last partial
+ * 32 bytes, leaving <i> where the scan ended. Only this function is compiled
+ * for AVX2, so it must not be called unless the CPU supports it.
+ *
+ * @return false if fn stopped the scan
+ */
+template <typename Fn>
+__attribute__((target("avx2")))
+static bool forEachBracketAvx2(const char* data, size_t size, size_t& i, Fn& fn) {
+    const __m256i brackets[6] = {_mm256_set1_epi8('('), _mm256_set1_epi8(')'), _mm256_set1_epi8('['),
+                                 _mm256_set1_epi8(']'), _mm256_set1_epi8('{'), _mm256_set1_epi8('}')};
+    for (; i + 32 <= size; i += 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i*) (data + i));
+        __m256i hits = _mm256_cmpeq_epi8(bytes, brackets[0]);
+        for (int b = 1; b < 6; b++) {
+            hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(bytes, brackets[b]));
+        }
+        uint32_t mask = _mm256_movemask_epi8(hits);
+        while (mask != 0) {
+            if (!fn(kBracketKinds[(uint8_t) data[i + __builtin_ctz(mask)]])) {
+                return false;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return true;
+}
+#endif
+
+/*
+ * Call fn(kind) for every bracket in <data>, in order, stopping as soon as
+ * fn returns false. On CPUs with AVX2 the bulk of the input goes through
+ * forEachBracketAvx2; the table lookup loop handles the rest.
+ *
+ * @return false if fn stopped the scan
+ */
+template <typename Fn>
+static inline bool forEachBracket(const char* data, size_t size, Fn fn) {
+    size_t i = 0;
+#if defined(BRACKETS_AVX2)
+    if (bracketScanUsesAvx2() && !forEachBracketAvx2(data, size, i, fn)) {
+        return false;
+    }
+#endif
+    for (; i < size; i++) {
+        int kind = kBracketKinds[(uint8_t) data[i]];
+        if (kind != 0 && !fn(kind)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+BracketChecker::BracketChecker() : depth(0), mismatched(false) {
+}
+
+/*
+ * Check the next <size> bytes of the input, continuing from the brackets
+ * still open after the previous chunk
+ *
+ * @return false as soon as a closing bracket does not match, after which
+ *         further input is ignored
+ */
+bool BracketChecker::feed(const char* data, size_t size) {
+    if (mismatched) {
+        return false;
+    }
+    return forEachBracket(data, size, [this](int kind) {
+        if (kind > 0) {
+            if (depth < kFixedDepth) {
+                fixed[depth] = kind;
+            } else {
+                deeper.push_back(kind);
+            }
+            depth++;
+            return true;
+        }
+        int open = depth == 0 ? 0 : depth <= kFixedDepth ? fixed[depth - 1] : deeper.back();
+        if (open != -kind) {
+            mismatched = true;
+            return false;
+        }
+        depth--;
+        if (depth >= kFixedDepth) {
+            deeper.pop_back();
+        }
+        return true;
+    });
+}
+
+/*
+ * Forget all input so far, to check a new one
+ */
+void BracketChecker::reset() {
+    deeper.clear();
+    depth = 0;
+    mismatched = false;
+}
+
+/*
+ * Same answer as isBalanced in one O(n) pass, with no regex and no copies
+ */
+bool isBalancedLinear(const string& str) {
+    BracketChecker checker;
+    checker.feed(str.data(), str.size());
+    return checker.balanced();
+}
+
+/*
+ * Check everything <in> holds, read <chunkBytes> at a time, so the input
+ * never has to fit in memory
+ */
+bool isBalancedStream(istream& in, size_t chunkBytes) {
+    BracketChecker checker;
+    vector<char> chunk(max(chunkBytes, (size_t) 1));
+    while (in) {
+        in.read(chunk.data(), chunk.size());
+        if (!checker.feed(chunk.data(), in.gcount())) {
+            return false;
+        }
+    }
+    return checker.balanced();
+}
+
+/*
+ * What a piece of input leaves unmatched once the brackets inside it cancel:
+ * closers with no opener before them, in order, then openers still waiting,
+ * from the bottom of the stack up (both as kinds 1-3). A closer that meets
+ * the wrong opener makes the whole input unbalanced.
+ */
+struct BracketSummary {
+    bool mismatched = false;
+    string closers;
+    string openers;
+};
+
+static BracketSummary summarize(const char* data, size_t size) {
+    BracketSummary summary;
+    vector<char> open(1024);
+    size_t depth = 0;
+    forEachBracket(data, size, [&](int kind) {
+        if (kind > 0) {
+            if (depth == open.size()) {
+                open.resize(2 * depth);
+            }
+            open[depth++] = kind;
+        } else if (depth == 0) {
+            summary.closers += (char) -kind;
+        } else if (open[depth - 1] == -kind) {
+            depth--;
+        } else {
+            summary.mismatched = true;
+            return false;
+        }
+        return true;
+    });
+    summary.openers.assign(open.data(), depth);
+    return summary;
+}
+
+/*
+ * Append the summary of the input just after <left>: its closers first meet
+ * the openers <left> leaves waiting. The combination is associative, so
+ * pieces can be summarized independently and folded in order.
+ */
+static void combine(BracketSummary& left, const BracketSummary& right) {
+    if (left.mismatched || right.mismatched) {
+        left.mismatched = true;
+        return;
+    }
+    for (char closer : right.closers) {
+        if (left.openers.empty()) {
+            left.closers += closer;
+        } else if (left.openers[left.openers.size() - 1] == closer) {
+            left.openers.pop_back();
+        } else {
+            left.mismatched = true;
+            return;
+        }
+    }
+    left.openers += right.openers;
+}
+
+/*
+ * Summarize <data> as <numThreads> pieces on as many threads and fold the
+ * pieces into <total>
+ */
+static void summarizeParallel(const char* data, size_t size, int numThreads, BracketSummary& total) {
+    numThreads = max(1, min(numThreads, (int) (size / 4096) + 1));
+    vector<BracketSummary> pieces(numThreads);
+    vector<thread> threads;
+    for (int t = 0; t < numThreads; t++) {
+        size_t begin = size * t / numThreads, end = size * (t + 1) / numThreads;
+        threads.emplace_back([&pieces, data, begin, end, t]() {
+            pieces[t] = summarize(data + begin, end - begin);
+        });
+    }
+    for (thread& t : threads) {
+        t.join();
+    }
+    for (const BracketSummary& piece : pieces) {
+        combine(total, piece);
+    }
+}
+
+/*
+ * The answer of isBalancedLinear, with the string checked in pieces on
+ * <numThreads> threads
+ */
+bool isBalancedParallel(const string& str, int numThreads) {
+    BracketSummary total;
+    summarizeParallel(str.data(), str.size(), numThreads, total);
+    return !total.mismatched && total.closers.empty() && total.openers.empty();
+}
+
+/*
+ * The answer of isBalancedStream, reading <chunkBytes> at a time and
+ * checking each chunk in pieces on <numThreads> threads, so a file of any
+ * size is checked in bounded memory at the speed of all the cores
+ */
+bool isBalancedParallel(istream& in, int numThreads, size_t chunkBytes) {
+    BracketSummary total;
+    vector<char> chunk(max(chunkBytes, (size_t) 1));
+    while (in) {
+        in.read(chunk.data(), chunk.size());
+        summarizeParallel(chunk.data(), in.gcount(), numThreads, total);
+        if (total.mismatched || !total.closers.empty()) {
+            return false;
+        }
+    }
+    return total.openers.empty();
+}
+
 /* * * * * * Test Cases * * * * * */
 
 PROVIDED_TEST("operatorsFrom on simple example") {
@@ -121,3 +397,145 @@ PROVIDED_TEST("isBalanced on non-balanced examples from writeup") {
     EXPECT(!isBalanced("3 ) ("));
     EXPECT(!isBalanced("{ ( x } y )"));
 }
+
+/* Test helper for random text with mostly balanced brackets, and sometimes a mistake */
+static string randomBracketText(int size) {
+    string text, open;
+    const string openers = "([{", closers = ")]}";
+    for (int i = 0; i < size; i++) {
+        int choice = randomInteger(0, 9);
+        if (choice < 3 && open.size() < 3000) {
+            int kind = randomInteger(0, 2);
+            text += openers[kind];
+            open += closers[kind];
+        } else if (choice < 6 && !open.empty()) {
+            text += open[open.size() - 1];
+            open.erase(open.size() - 1);
+        } else {
+            text += (char) randomInteger('a', 'z');
+        }
+    }
+    if (randomChance(0.5)) {
+        text += string(open.rbegin(), open.rend());
+    }
+    if (randomChance(0.2) && !text.empty()) {
+        text[randomInteger(0, text.size() - 1)] = closers[randomInteger(0, 2)];
+    }
+    return text;
+}
+
+STUDENT_TEST("isBalancedLinear and isBalancedStream agree with isBalanced") {
+    string example = "int main() { int x = 2 * (vec[2] + 3); x = (1 + random()); }";
+    EXPECT(isBalancedLinear(example));
+    EXPECT(isBalancedLinear(""));
+    EXPECT(!isBalancedLinear("( ( [ a ] )"));
+    EXPECT(!isBalancedLinear("3 ) ("));
+    EXPECT(!isBalancedLinear("{ ( x } y )"));
+    EXPECT(!isBalancedLinear("\xff)"));
+
+    for (int trial = 0; trial < 300; trial++) {
+        string text = randomBracketText(randomInteger(0, 400));
+        bool expected = isBalanced(text);
+        EXPECT_EQUAL(isBalancedLinear(text), expected);
+        for (size_t chunk : {1, 3, 64}) {
+            istringstream in(text);
+            EXPECT_EQUAL(isBalancedStream(in, chunk), expected);
+        }
+    }
+}
+
+STUDENT_TEST("BracketChecker nests past its fixed stack and resets") {
+    int depth = 100000;
+    string nested = string(depth, '[') + string(depth, '{') + string(depth, '}') + string(depth, ']');
+    EXPECT(isBalancedLinear(nested));
+    EXPECT(!isBalancedLinear(nested.substr(1)));
+    EXPECT(!isBalancedLinear(nested + ")"));
+
+    BracketChecker checker;
+    EXPECT(!checker.feed("(]", 2));
+    EXPECT(!checker.feed("", 0));
+    EXPECT(!checker.balanced());
+    checker.reset();
+    EXPECT(checker.feed("(", 1));
+    EXPECT(!checker.balanced());
+    EXPECT(checker.feed(")", 1));
+    EXPECT(checker.balanced());
+}
+
+STUDENT_TEST("Time isBalanced against the linear and streaming checkers") {
+    // isBalanced rescans and copies the string for every pair, so it only gets small inputs
+    for (int size = 1 << 10; size <= 1 << 16; size *= 4) {
+        string text = randomBracketText(size);
+        TIME_OPERATION(size, isBalanced(text));
+        TIME_OPERATION(size, isBalancedLinear(text));
+    }
+
+    // code-like text, 1 MB of it, repeated to make inputs from 1 MB to 1 GB
+    string block;
+    while (block.size() < (1 << 20)) {
+        block += "int main() { int x = 2 * (vec[2] + 3); x = (1 + random()); }\n";
+    }
+    block.resize(1 << 20);
+    size_t lastLine = block.rfind('\n') + 1;
+    block.replace(lastLine, block.size() - lastLine, block.size() - lastLine, ' ');
+    EXPECT(isBalancedLinear(block));
+    for (int megabytes = 1; megabytes <= 1024; megabytes *= 4) {
+        BracketChecker checker;
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < megabytes; i++) {
+            checker.feed(block.data(), block.size());
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        EXPECT(checker.balanced());
+        cout << megabytes << " MB in 1 MB chunks: " << megabytes / seconds << " MB/s" << endl;
+    }
+    string whole;
+    for (int i = 0; i < 64; i++) {
+        whole += block;
+    }
+    TIME_OPERATION(whole.size(), isBalancedLinear(whole));
+    istringstream in(whole);
+    TIME_OPERATION(whole.size(), isBalancedStream(in));
+}
+
+STUDENT_TEST("isBalancedParallel agrees with the sequential checker") {
+    for (int trial = 0; trial < 300; trial++) {
+        string text = randomBracketText(randomInteger(0, 20000));
+        if (randomChance(0.3)) {
+            // long runs without brackets, and brackets on 32-byte boundaries
+            text = string(randomInteger(0, 100), 'x') + text + string(31, ' ') + "()" + string(64, 'y');
+        }
+        bool expected = isBalancedLinear(text);
+        for (int threads : {1, 2, 3, 8}) {
+            EXPECT_EQUAL(isBalancedParallel(text, threads), expected);
+            istringstream in(text);
+            EXPECT_EQUAL(isBalancedParallel(in, threads, randomInteger(1, 5000)), expected);
+        }
+    }
+    string split = string(5000, '(') + string(5000, '[') + string(5000, ']') + string(5000, ')');
+    EXPECT(isBalancedParallel(split, 4));
+    EXPECT(!isBalancedParallel(split + "]", 4));
+    EXPECT(!isBalancedParallel(")" + split, 4));
+}
+
+STUDENT_TEST("Time isBalancedLinear against isBalancedParallel from 1 to N threads") {
+    string line = "int main() { int x = 2 * (vec[2] + 3); x = (1 + random()); }\n";
+    string text;
+    while (text.size() < (256 << 20)) {
+        text += line;
+    }
+    cout << "bracket scan: " << (bracketScanUsesAvx2() ? "AVX2, 32 bytes at a time" : "scalar") << endl;
+    auto start = chrono::steady_clock::now();
+    bool balanced = isBalancedLinear(text);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "isBalancedLinear: " << text.size() / seconds / (1 << 20) << " MB/s" << endl;
+    EXPECT(balanced);
+    int maxThreads = max(4, (int) thread::hardware_concurrency());
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        start = chrono::steady_clock::now();
+        balanced = isBalancedParallel(text, threads);
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << "isBalancedParallel, " << threads << " threads: " << text.size() / seconds / (1 << 20) << " MB/s" << endl;
+        EXPECT(balanced);
+    }
+}
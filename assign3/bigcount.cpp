@@ -0,0 +1,338 @@
+#include <algorithm>
+#include <climits>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "bigcount.h"
+#include "error.h"
+#include "random.h"
+#include "testing/SimpleTest.h"
+using namespace std;
+
+BigCount::BigCount(uint64_t value) : limbs(1, value) {
+}
+
+BigCount::BigCount(const uint64_t* limbs, int numLimbs) : limbs(limbs, limbs + numLimbs) {
+    if (this->limbs.empty()) {
+        this->limbs.push_back(0);
+    }
+    trim();
+}
+
+void BigCount::trim() {
+    while (limbs.size() > 1 && limbs.back() == 0) {
+        limbs.pop_back();
+    }
+}
+
+BigCount& BigCount::operator+=(const BigCount& other) {
+    if (limbs.size() < other.limbs.size()) {
+        limbs.resize(other.limbs.size(), 0);
+    }
+    uint64_t carry = addLimbs(limbs.data(), limbs.size(), other.limbs.data(), other.limbs.size());
+    if (carry != 0) {
+        limbs.push_back(carry);
+    }
+    return *this;
+}
+
+static const int kKaratsubaLimbs = 32;
+
+/*
+ * Writes the product of the <na> limbs at <a> and the <nb> limbs at <b> to
+ * the na + nb limbs at <out>, which must not overlap either factor. Short
+ * factors are multiplied limb by limb; a factor more than twice as long as
+ * the other is cut into pieces as long as the other; two long factors of
+ * similar length are split in halves, a = a1 B + a0 and b = b1 B + b0, and
+ * multiplied with three half-size products instead of four:
+ * a b = a1 b1 B^2 + ((a0 + a1)(b0 + b1) - a0 b0 - a1 b1) B + a0 b0.
+ */
+static void multiplyLimbs(const uint64_t* a, int na, const uint64_t* b, int nb, uint64_t* out) {
+    if (na < nb) {
+        swap(a, b);
+        swap(na, nb);
+    }
+    fill(out, out + na + nb, 0);
+    if (nb < kKaratsubaLimbs) {
+        for (int j = 0; j < nb; j++) {
+            uint64_t carry = 0;
+            for (int i = 0; i < na; i++) {
+                unsigned __int128 product = (unsigned __int128) a[i] * b[j] + out[i + j] + carry;
+                out[i + j] = (uint64_t) product;
+                carry = (uint64_t) (product >> 64);
+            }
+            out[na + j] = carry;
+        }
+    } else if (na >= 2 * nb) {
+        vector<uint64_t> piece(2 * nb);
+        for (int start = 0; start < na; start += nb) {
+            int length = min(nb, na - start);
+            multiplyLimbs(a + start, length, b, nb, piece.data());
+            addLimbs(out + start, na + nb - start, piece.data(), length + nb);
+        }
+    } else {
+        int half = na / 2;              // < nb, so both factors have a high half
+        vector<uint64_t> low(2 * half);
+        vector<uint64_t> high(na + nb - 2 * half);
+        multiplyLimbs(a, half, b, half, low.data());
+        multiplyLimbs(a + half, na - half, b + half, nb - half, high.data());
+
+        vector<uint64_t> sumA(a + half, a + na);
+        sumA.push_back(addLimbs(sumA.data(), na - half, a, half));
+        vector<uint64_t> sumB = (nb - half >= half ? vector<uint64_t>(b + half, b + nb)
+                                                   : vector<uint64_t>(b, b + half));
+        int longB = sumB.size();
+        sumB.push_back(nb - half >= half ? addLimbs(sumB.data(), longB, b, half)
+                                         : addLimbs(sumB.data(), longB, b + half, nb - half));
+
+        vector<uint64_t> middle(sumA.size() + sumB.size());
+        multiplyLimbs(sumA.data(), sumA.size(), sumB.data(), sumB.size(), middle.data());
+        subtractLimbs(middle.data(), middle.size(), low.data(), low.size());
+        subtractLimbs(middle.data(), middle.size(), high.data(), high.size());
+
+        copy(low.begin(), low.end(), out);
+        copy(high.begin(), high.end(), out + 2 * half);
+        int room = na + nb - half;      // the middle term fits, its top limbs are zero
+        addLimbs(out + half, room, middle.data(), min((int) middle.size(), room));
+    }
+}
+
+BigCount& BigCount::operator*=(const BigCount& other) {
+    vector<uint64_t> product(limbs.size() + other.limbs.size());
+    multiplyLimbs(limbs.data(), limbs.size(), other.limbs.data(), other.limbs.size(), product.data());
+    limbs.swap(product);
+    trim();
+    return *this;
+}
+
+BigCount& BigCount::operator-=(const BigCount& other) {
+    if (*this < other) {
+        error("BigCount cannot go below zero");
+    }
+    subtractLimbs(limbs.data(), limbs.size(), other.limbs.data(), other.limbs.size());
+    trim();
+    return *this;
+}
+
+BigCount operator*(const BigCount& a, const BigCount& b) {
+    BigCount product = a;
+    product *= b;
+    return product;
+}
+
+BigCount& BigCount::operator<<=(int bits) {
+    if (bits < 0) {
+        error("BigCount cannot shift by a negative number of bits");
+    }
+    int whole = bits / 64;
+    int part = bits % 64;
+    if (part != 0) {
+        limbs.push_back(0);
+        for (int i = limbs.size() - 1; i > 0; i--) {
+            limbs[i] = (limbs[i] << part) | (limbs[i - 1] >> (64 - part));
+        }
+        limbs[0] <<= part;
+    }
+    limbs.insert(limbs.begin(), whole, 0);
+    trim();
+    return *this;
+}
+
+/*
+ * @return This number modulo <modulus>, one limb at a time from the top
+ */
+uint64_t BigCount::remainder(uint64_t modulus) const {
+    if (modulus == 0) {
+        error("BigCount remainder by zero");
+    }
+    unsigned __int128 rest = 0;
+    for (int i = limbs.size() - 1; i >= 0; i--) {
+        rest = ((rest << 64) | limbs[i]) % modulus;
+    }
+    return (uint64_t) rest;
+}
+
+/*
+ * @return The number of bits up to the highest set bit, 0 for zero
+ */
+long long BigCount::numBits() const {
+    uint64_t top = limbs.back();
+    return 64LL * (limbs.size() - 1) + (top == 0 ? 0 : 64 - __builtin_clzll(top));
+}
+
+bool BigCount::operator==(const BigCount& other) const {
+    return limbs == other.limbs;
+}
+
+bool BigCount::operator<(const BigCount& other) const {
+    if (limbs.size() != other.limbs.size()) {
+        return limbs.size() < other.limbs.size();
+    }
+    for (int i = limbs.size() - 1; i >= 0; i--) {
+        if (limbs[i] != other.limbs[i]) {
+            return limbs[i] < other.limbs[i];
+        }
+    }
+    return false;
+}
+
+double BigCount::toDouble() const {
+    double value = 0;
+    for (int i = limbs.size() - 1; i >= 0; i--) {
+        value = value * 18446744073709551616.0 + limbs[i];
+    }
+    return value;
+}
+
+/*
+ * @return This count divided by <whole>, computed from the top 128 bits of
+ *         both so that counts too large for a double still give a ratio
+ */
+double BigCount::fractionOf(const BigCount& whole) const {
+    int top = max(limbs.size(), whole.limbs.size()) - 1;
+    auto leading = [top](const vector<uint64_t>& limbs) {
+        double high = top < (int) limbs.size() ? limbs[top] : 0;
+        double next = top >= 1 && top - 1 < (int) limbs.size() ? limbs[top - 1] : 0;
+        return high * 18446744073709551616.0 + next;
+    };
+    return leading(limbs) / leading(whole.limbs);
+}
+
+/*
+ * @return floor(100 * this / whole) exactly, by long division of 100 times
+ *         this count by <whole>, one quotient bit at a time; the count must
+ *         be at most <whole>
+ */
+int BigCount::percentOf(const BigCount& whole) const {
+    if (whole == BigCount(0) || whole < *this) {
+        error("BigCount percentOf needs a part no larger than a non-zero whole");
+    }
+    BigCount rest = *this * BigCount(100);
+    int quotient = 0;
+    for (long long bit = rest.numBits() - whole.numBits(); bit >= 0; bit--) {
+        BigCount part = whole;
+        part <<= bit;
+        if (!(rest < part)) {
+            rest -= part;
+            quotient |= 1 << bit;
+        }
+    }
+    return quotient;
+}
+
+/*
+ * @return The count in decimal, converted 19 digits at a time
+ */
+string BigCount::toString() const {
+    vector<uint64_t> rest = limbs;
+    vector<uint64_t> chunks;
+    const uint64_t kChunk = 10000000000000000000ULL;
+    while (rest.size() > 1 || rest[0] != 0) {
+        unsigned __int128 remainder = 0;
+        for (int i = rest.size() - 1; i >= 0; i--) {
+            unsigned __int128 current = (remainder << 64) | rest[i];
+            rest[i] = current / kChunk;
+            remainder = current % kChunk;
+        }
+        chunks.push_back(remainder);
+        while (rest.size() > 1 && rest.back() == 0) {
+            rest.pop_back();
+        }
+    }
+    if (chunks.empty()) {
+        return "0";
+    }
+    string result = to_string(chunks.back());
+    for (int i = chunks.size() - 2; i >= 0; i--) {
+        string digits = to_string(chunks[i]);
+        result += string(19 - digits.size(), '0') + digits;
+    }
+    return result;
+}
+
+ostream& operator<<(ostream& out, const BigCount& count) {
+    return out << count.toString();
+}
+
+
+/* * * * * * Test Cases * * * * * */
+
+STUDENT_TEST("BigCount adds, compares and prints") {
+    BigCount count(UINT64_MAX);
+    count += BigCount(1);
+    EXPECT_EQUAL(count.toString(), "18446744073709551616");
+    EXPECT_EQUAL(count.low(), 0);
+    EXPECT_EQUAL(count.toDouble(), 18446744073709551616.0);
+    EXPECT_EQUAL(BigCount().toString(), "0");
+    EXPECT_EQUAL(BigCount(1234567890123ULL).toString(), "1234567890123");
+    uint64_t limbs[3] = {5, 0, 0};
+    EXPECT_EQUAL(BigCount(limbs, 3), BigCount(5));
+    EXPECT(BigCount(limbs, 3) != count);
+    EXPECT_EQUAL(BigCount(1).fractionOf(BigCount(4)), 0.25);
+}
+
+STUDENT_TEST("BigCount multiplies and shifts, matching remainders for Karatsuba sizes") {
+    BigCount count(UINT64_MAX);
+    count *= BigCount(UINT64_MAX);
+    EXPECT_EQUAL(count.toString(), "340282366920938463426481119284349108225");
+    EXPECT_EQUAL(count.numBits(), 128);
+    EXPECT_EQUAL(BigCount(12345) * BigCount(0), BigCount(0));
+    EXPECT_EQUAL(BigCount().numBits(), 0);
+    BigCount shifted(3);
+    shifted <<= 130;
+    EXPECT_EQUAL(shifted.numBits(), 132);
+    EXPECT_EQUAL(shifted.remainder(1000000007), 355587303);
+
+    // a product checked modulo two primes, for factors on both sides of the
+    // Karatsuba cutoff and of very different lengths
+    const uint64_t p = 1000000007;
+    const uint64_t q = (1ULL << 61) - 1;
+    for (int na : {1, 5, 31, 32, 33, 64, 100, 257}) {
+        for (int nb : {1, 31, 40, 97, 300}) {
+            vector<uint64_t> x(na);
+            vector<uint64_t> y(nb);
+            for (uint64_t& limb : x) {
+                limb = ((uint64_t) randomInteger(0, INT_MAX) << 33) ^ randomInteger(0, INT_MAX);
+            }
+            for (uint64_t& limb : y) {
+                limb = randomChance(0.1) ? UINT64_MAX : ((uint64_t) randomInteger(0, INT_MAX) << 31);
+            }
+            BigCount a(x.data(), na);
+            BigCount b(y.data(), nb);
+            BigCount product = a * b;
+            for (uint64_t modulus : {p, q}) {
+                unsigned __int128 expected = (unsigned __int128) a.remainder(modulus) * b.remainder(modulus);
+                EXPECT_EQUAL(product.remainder(modulus), (uint64_t) (expected % modulus));
+            }
+            EXPECT(product.numBits() >= a.numBits() + b.numBits() - 1);
+            EXPECT(product.numBits() <= a.numBits() + b.numBits());
+        }
+    }
+}
+
+STUDENT_TEST("BigCount percentOf rounds down exactly, however large the counts") {
+    EXPECT_EQUAL(BigCount(1).percentOf(BigCount(4)), 25);
+    EXPECT_EQUAL(BigCount(29).percentOf(BigCount(100)), 29);
+    EXPECT_EQUAL(BigCount(0).percentOf(BigCount(7)), 0);
+    EXPECT_EQUAL(BigCount(7).percentOf(BigCount(7)), 100);
+    for (int trial = 0; trial < 200; trial++) {
+        vector<uint64_t> limbs(randomInteger(1, 6));
+        for (uint64_t& limb : limbs) {
+            limb = ((uint64_t) randomInteger(0, INT_MAX) << 33) ^ randomInteger(0, INT_MAX);
+        }
+        BigCount quarter(limbs.data(), limbs.size());
+        if (quarter == BigCount(0)) {
+            continue;
+        }
+        BigCount whole = quarter * BigCount(4);
+        EXPECT_EQUAL(quarter.percentOf(whole), 25);
+        BigCount less = whole;
+        less -= BigCount(1);
+        EXPECT_EQUAL(less.percentOf(whole), 99);
+        EXPECT_EQUAL(quarter.percentOf(whole * BigCount(3)), 8);
+    }
+    EXPECT_ERROR(BigCount(5).percentOf(BigCount(4)));
+    EXPECT_ERROR(BigCount(0).percentOf(BigCount(0)));
+    BigCount small(1);
+    EXPECT_ERROR(small -= BigCount(2));
+}
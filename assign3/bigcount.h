@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/*
+ * Adds the <ny> limbs at <y> into the <nx> limbs at <x>, little-endian 64-bit
+ * limbs, ny <= nx
+ *
+ * @return The carry out of the top limb
+ */
+inline uint64_t addLimbs(uint64_t* x, int nx, const uint64_t* y, int ny) {
+    uint64_t carry = 0;
+    for (int i = 0; i < nx && (i < ny || carry != 0); i++) {
+        uint64_t add = (i < ny ? y[i] : 0);
+        uint64_t sum = x[i] + add;
+        uint64_t carryOut = sum < add;
+        x[i] = sum + carry;
+        carry = carryOut | (x[i] < carry);
+    }
+    return carry;
+}
+
+/*
+ * Subtracts the <ny> limbs at <y> from the <nx> limbs at <x>, which must hold
+ * at least as large a number
+ */
+inline void subtractLimbs(uint64_t* x, int nx, const uint64_t* y, int ny) {
+    uint64_t borrow = 0;
+    for (int i = 0; i < nx && (i < ny || borrow != 0); i++) {
+        uint64_t sub = (i < ny ? y[i] : 0);
+        uint64_t difference = x[i] - sub;
+        uint64_t borrowOut = x[i] < sub;
+        borrowOut |= difference < borrow;
+        x[i] = difference - borrow;
+        borrow = borrowOut;
+    }
+}
+
+/*
+ * Non-negative integer of any size, as little-endian 64-bit limbs, with just
+ * what exact power indexes (voting.cpp) and exact factorials (warmup) need:
+ * adding, subtracting, multiplying, shifting, comparing and converting.
+ * Products of two numbers of at least 32 limbs each use Karatsuba's method,
+ * O(n^1.585) instead of O(n^2).
+ */
+class BigCount {
+public:
+    BigCount(uint64_t value = 0);
+    BigCount(const uint64_t* limbs, int numLimbs);
+
+    BigCount& operator+=(const BigCount& other);
+    BigCount& operator-=(const BigCount& other);
+    BigCount& operator*=(const BigCount& other);
+    BigCount& operator<<=(int bits);
+    bool operator==(const BigCount& other) const;
+    bool operator!=(const BigCount& other) const { return !(*this == other); }
+    bool operator<(const BigCount& other) const;
+
+    uint64_t low() const { return limbs[0]; }
+    uint64_t remainder(uint64_t modulus) const;
+    long long numBits() const;
+    double toDouble() const;
+    double fractionOf(const BigCount& whole) const;
+    int percentOf(const BigCount& whole) const;
+    std::string toString() const;
+
+private:
+    void trim();
+
+    std::vector<uint64_t> limbs;     // never empty, no leading zero limbs beyond the first
+};
+
+BigCount operator*(const BigCount& a, const BigCount& b);
+std::ostream& operator<<(std::ostream& out, const BigCount& count);
@@ -0,0 +1,484 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+#include "bogglegen.h"
+#include "bogglesolver.h"
+#include "error.h"
+#include "random.h"
+#include "testing/SimpleTest.h"
+using namespace std;
+
+/* * * * * * IncrementalScorer * * * * * */
+
+/*
+ * Compute the height and letters below every trie node. A node's children are
+ * always stored after it, so one pass from the last node back sees every
+ * child first.
+ */
+IncrementalScorer::IncrementalScorer(const WordTrie& trie)
+    : trie(trie), height(trie.numNodes(), 0), lettersBelow(trie.numNodes(), 0), pathCount(trie.numNodes(), 0),
+      rows(0), cols(0), total(0), numEvaluations(0), target(-1), oldLetter(-1), newLetter(-1), targetLetters(0),
+      undoCell(-1), undoLetter(0), undoTotal(0) {
+    for (int node = trie.numNodes() - 1; node >= 0; node--) {
+        for (int letter = 0; letter < 26; letter++) {
+            int child = trie.child(node, letter);
+            if (child >= 0) {
+                height[node] = max<int>(height[node], height[child] + 1);
+                lettersBelow[node] |= (1u << letter) | lettersBelow[child];
+            }
+        }
+    }
+}
+
+/*
+ * Score a new board from scratch
+ * @return The score of <board>
+ */
+int IncrementalScorer::reset(const Grid<char>& board) {
+    if (board.numRows() * board.numCols() > 64) {
+        error("IncrementalScorer supports boards of at most 64 cubes");
+    }
+    fill(pathCount.begin(), pathCount.end(), 0);
+    cubes = board;
+    rows = board.numRows();
+    cols = board.numCols();
+    letters.assign(rows * cols, -1);
+    neighbors.assign(8 * rows * cols, 0);
+    numNeighbors.assign(rows * cols, 0);
+    for (int cell = 0; cell < rows * cols; cell++) {
+        char ch = toupper(board[cell / cols][cell % cols]);
+        letters[cell] = (ch >= 'A' && ch <= 'Z') ? ch - 'A' : -1;
+        int row = cell / cols, col = cell % cols;
+        for (int r = max(row - 1, 0); r <= min(row + 1, rows - 1); r++) {
+            for (int c = max(col - 1, 0); c <= min(col + 1, cols - 1); c++) {
+                if (r != row || c != col) {
+                    neighbors[8 * cell + numNeighbors[cell]++] = r * cols + c;
+                }
+            }
+        }
+    }
+    total = 0;
+    numEvaluations++;
+
+    target = -1;
+    undoCell = -1;
+    for (int cell = 0; cell < rows * cols; cell++) {
+        walk(cell, WordTrie::kRoot, 0, 0, +1);
+    }
+    return total;
+}
+
+/*
+ * Replace the letter of one cube and update the score. The change can be
+ * taken back with undo() until the next change.
+ *
+ * @return The score of the board after the change
+ */
+int IncrementalScorer::change(int row, int col, char letter) {
+    if (!cubes.inBounds(row, col)) {
+        error("Board location out of bounds");
+    }
+    int cell = row * cols + col;
+    char ch = toupper(letter);
+    numEvaluations++;
+    undoLog.clear();
+    undoCell = cell;
+    undoLetter = cubes[row][col];
+    undoTotal = total;
+
+    target = cell;
+    oldLetter = letters[cell];
+    newLetter = (ch >= 'A' && ch <= 'Z') ? ch - 'A' : -1;
+    targetLetters = (oldLetter >= 0 ? 1u << oldLetter : 0) | (newLetter >= 0 ? 1u << newLetter : 0);
+    for (int start = 0; start < rows * cols; start++) {
+        walk(start, WordTrie::kRoot, 0, 0, 0);
+    }
+    letters[cell] = newLetter;
+    cubes[row][col] = letter;
+    return total;
+}
+
+/*
+ * Take back the last change, restoring the counts it modified from the log
+ * instead of walking the board again
+ */
+void IncrementalScorer::undo() {
+    if (undoCell < 0) {
+        error("No change to undo");
+    }
+    for (int i = undoLog.size() - 1; i >= 0; i--) {
+        pathCount[undoLog[i].first] -= undoLog[i].second;
+    }
+    undoLog.clear();
+    char ch = toupper(undoLetter);
+    letters[undoCell] = (ch >= 'A' && ch <= 'Z') ? ch - 'A' : -1;
+    cubes[undoCell / cols][undoCell % cols] = undoLetter;
+    total = undoTotal;
+    undoCell = -1;
+}
+
+/*
+ * Extend the path ending at trie node <node> onto <cell>, then keep extending.
+ *
+ * With <delta> 0 the path has not reached the target cube yet and nothing is
+ * counted. Entering the target cube splits the walk in two: one continues
+ * with the target's old letter and uncounts (-1) every word it spells, the
+ * other continues with the new letter and counts (+1) them. The part of the
+ * path before the target is walked only once for both. With no target, as in
+ * reset(), every path counts (+1) from its first cube.
+ */
+void IncrementalScorer::walk(int cell, int node, uint64_t visited, int length, int delta) {
+    if (cell == target && delta == 0) {
+        letters[cell] = oldLetter;
+        walk(cell, node, visited, length, -1);
+        letters[cell] = newLetter;
+        walk(cell, node, visited, length, +1);
+        return;
+    }
+    if (letters[cell] < 0) {
+        return;
+    }
+    node = trie.child(node, letters[cell]);
+    if (node < 0) {
+        return;
+    }
+    if (delta == 0) {
+        // the words below must still reach the target, in as many letters as
+        // it is away, with one of the target's letters
+        int away = max(abs(cell / cols - target / cols), abs(cell % cols - target % cols));
+        if (away > height[node] || !(lettersBelow[node] & targetLetters)) {
+            return;
+        }
+    }
+    visited |= uint64_t(1) << cell;
+    length++;
+
+    if (delta != 0 && length >= 4 && trie.isWord(node)) {
+        pathCount[node] += delta;
+        if (target >= 0) {
+            undoLog.push_back({node, delta});
+        }
+        if (delta > 0 && pathCount[node] == 1) {
+            total += length - 3;
+        } else if (delta < 0 && pathCount[node] == 0) {
+            total -= length - 3;
+        }
+    }
+    const uint8_t* next = &neighbors[8 * cell];
+    for (int i = numNeighbors[cell] - 1; i >= 0; i--) {
+        if (!(visited & (uint64_t(1) << next[i]))) {
+            walk(next[i], node, visited, length, delta);
+        }
+    }
+}
+
+/* * * * * * Annealing * * * * * */
+
+static const char* kCubes[16] = {
+    "AAEEGN", "ABBJOO", "ACHOPS", "AFFKPS", "AOOTTW", "CIMOTU", "DEILRX", "DELRVY",
+    "DISTTY", "EEGHNW", "EEINSU", "EHRTVW", "EIOSST", "ELRTTY", "HIMNQU", "HLNNRZ"
+};
+
+/*
+ * @return The value annealing maximizes: the score, or minus the distance of
+ *         the score from the target range if there is one
+ */
+static int objective(int score, const AnnealOptions& options) {
+    if (options.maxScore <= 0) {
+        return score;
+    }
+    if (score < options.minScore) return score - options.minScore;
+    if (score > options.maxScore) return options.maxScore - score;
+    return 0;
+}
+
+/*
+ * Same interface as IncrementalScorer, but every change rescores the whole
+ * board with a BoggleSolver. On boards below 6x6 most paths pass through any
+ * given cube, so walking only those paths saves less than the path counting
+ * costs: a full rescore is about 1.4x faster there. undo() just puts back the
+ * old letter and score.
+ */
+class FullRescorer {
+public:
+    FullRescorer(const WordTrie& trie)
+        : solver(trie), total(0), numEvaluations(0), undoRow(-1), undoCol(-1), undoLetter(0), undoTotal(0) {
+    }
+
+    int reset(const Grid<char>& board) {
+        cubes = board;
+        undoRow = -1;
+        numEvaluations++;
+        return total = solver.score(cubes);
+    }
+
+    int change(int row, int col, char letter) {
+        if (!cubes.inBounds(row, col)) {
+            error("FullRescorer change is off the board");
+        }
+        undoRow = row;
+        undoCol = col;
+        undoLetter = cubes[row][col];
+        undoTotal = total;
+        cubes[row][col] = letter;
+        numEvaluations++;
+        return total = solver.score(cubes);
+    }
+
+    void undo() {
+        if (undoRow < 0) {
+            error("FullRescorer has no change to undo");
+        }
+        cubes[undoRow][undoCol] = undoLetter;
+        total = undoTotal;
+        undoRow = -1;
+    }
+
+    int score() const { return total; }
+    const Grid<char>& board() const { return cubes; }
+    long long evaluations() const { return numEvaluations; }
+
+private:
+    BoggleSolver solver;
+    Grid<char> cubes;
+    int total;
+    long long numEvaluations;
+    int undoRow;
+    int undoCol;
+    char undoLetter;
+    int undoTotal;
+};
+
+// boards with at least this many cubes are scored incrementally
+static const int kIncrementalMinCubes = 36;
+
+/*
+ * Run one annealing chain with its own random generator and <Scorer>, either
+ * IncrementalScorer or FullRescorer, recording the time and score each time
+ * its best board improves
+ */
+template <typename Scorer>
+static GeneratedBoard runChain(const WordTrie& trie, const AnnealOptions& options, unsigned seed,
+                               chrono::steady_clock::time_point begin) {
+    mt19937 random(seed);
+    auto randomLetter = [&random]() {
+        return kCubes[random() % 16][random() % 6];
+    };
+    Grid<char> board(options.size, options.size);
+    for (int r = 0; r < options.size; r++) {
+        for (int c = 0; c < options.size; c++) {
+            board[r][c] = randomLetter();
+        }
+    }
+
+    Scorer scorer(trie);
+    GeneratedBoard best;
+    best.score = scorer.reset(board);
+    best.board = board;
+    int current = objective(best.score, options);
+    auto elapsed = [begin]() {
+        return chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    };
+    best.bestOverTime.add({elapsed(), best.score});
+    uniform_real_distribution<double> chance(0, 1);
+
+    for (int step = 0; step < options.steps && !(options.maxScore > 0 && current == 0); step++) {
+        double temperature = options.startTemperature
+                * pow(options.endTemperature / options.startTemperature, step / (double) options.steps);
+        int row = random() % options.size;
+        int col = random() % options.size;
+        char letter = randomLetter();
+        if (letter == scorer.board()[row][col]) {
+            continue;
+        }
+        int score = scorer.change(row, col, letter);
+        int delta = objective(score, options) - current;
+        if (delta >= 0 || chance(random) < exp(delta / temperature)) {
+            current += delta;
+            if (current > objective(best.score, options)) {
+                best.score = score;
+                best.board = scorer.board();
+                best.bestOverTime.add({elapsed(), score});
+            }
+        } else {
+            scorer.undo();
+        }
+    }
+    best.evaluations = scorer.evaluations();
+    return best;
+}
+
+/*
+ * Generate a board by running options.numChains annealing chains in parallel
+ * and keeping the best board any of them found. Chains draw letters from the
+ * faces of the standard 16 cubes, so boards look like real rolls. Boards of
+ * 6x6 and up are scored incrementally, smaller ones by full rescores, which
+ * are faster there.
+ *
+ * @return The best board with its score, the evaluations done by all chains,
+ *         the elapsed time, and the best score over time across all chains
+ */
+GeneratedBoard generateBoard(const WordTrie& trie, const AnnealOptions& options) {
+    if (options.size < 1 || options.size > 8 || options.numChains < 1 || options.steps < 0) {
+        error("Invalid annealing options");
+    }
+    if (options.startTemperature <= 0 || options.endTemperature <= 0) {
+        error("Annealing temperatures must be positive");
+    }
+    auto begin = chrono::steady_clock::now();
+    vector<GeneratedBoard> chains(options.numChains);
+    vector<unsigned> seeds;
+    for (int i = 0; i < options.numChains; i++) {
+        seeds.push_back(randomInteger(0, INT32_MAX));
+    }
+    vector<thread> threads;
+    for (int i = 0; i < options.numChains; i++) {
+        threads.emplace_back([&, i]() {
+            if (options.size * options.size >= kIncrementalMinCubes) {
+                chains[i] = runChain<IncrementalScorer>(trie, options, seeds[i], begin);
+            } else {
+                chains[i] = runChain<FullRescorer>(trie, options, seeds[i], begin);
+            }
+        });
+    }
+    for (thread& t : threads) {
+        t.join();
+    }
+
+    GeneratedBoard result = chains[0];
+    result.evaluations = 0;
+    vector<pair<double, int>> improvements;
+    for (const GeneratedBoard& chain : chains) {
+        if (objective(chain.score, options) > objective(result.score, options)) {
+            result.board = chain.board;
+            result.score = chain.score;
+        }
+        result.evaluations += chain.evaluations;
+        for (const pair<double, int>& point : chain.bestOverTime) {
+            improvements.push_back(point);
+        }
+    }
+    sort(improvements.begin(), improvements.end());
+    result.bestOverTime.clear();
+    for (const pair<double, int>& point : improvements) {
+        if (result.bestOverTime.isEmpty()
+                || objective(point.second, options) > objective(result.bestOverTime[result.bestOverTime.size() - 1].second, options)) {
+            result.bestOverTime.add(point);
+        }
+    }
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    return result;
+}
+
+
+/* * * * * * Test Cases * * * * * */
+
+/* Test helper to return a shared copy of the word list trie, built once */
+static const WordTrie& sharedTrie() {
+    static WordTrie trie("res/EnglishWords.txt");
+    return trie;
+}
+
+/* Test helper to make <count> random single-cube changes, scoring fully after each */
+static int changeAndRescore(BoggleSolver& solver, Grid<char>& board, int count) {
+    int total = 0;
+    for (int i = 0; i < count; i++) {
+        board[randomInteger(0, board.numRows() - 1)][randomInteger(0, board.numCols() - 1)]
+                = kCubes[randomInteger(0, 15)][randomInteger(0, 5)];
+        total += solver.score(board);
+    }
+    return total;
+}
+
+static int changeIncrementally(IncrementalScorer& scorer, int count) {
+    int size = scorer.board().numRows();
+    int total = 0;
+    for (int i = 0; i < count; i++) {
+        total += scorer.change(randomInteger(0, size - 1), randomInteger(0, size - 1),
+                               kCubes[randomInteger(0, 15)][randomInteger(0, 5)]);
+    }
+    return total;
+}
+
+STUDENT_TEST("IncrementalScorer stays equal to a full rescore through random changes") {
+    BoggleSolver solver(sharedTrie());
+    IncrementalScorer scorer(sharedTrie());
+    for (int size : {1, 3, 4, 5, 8}) {
+        Grid<char> board(size, size, 'E');
+        EXPECT_EQUAL(scorer.reset(board), solver.score(board));
+        for (int step = 0; step < 200; step++) {
+            int row = randomInteger(0, size - 1), col = randomInteger(0, size - 1);
+            char letter = randomChance(0.05) ? '_' : kCubes[randomInteger(0, 15)][randomInteger(0, 5)];
+            if (randomChance(0.3)) {
+                scorer.change(row, col, letter);
+                scorer.undo();
+                EXPECT_EQUAL(scorer.score(), solver.score(board));
+            } else {
+                board[row][col] = letter;
+                EXPECT_EQUAL(scorer.change(row, col, letter), solver.score(board));
+            }
+        }
+        EXPECT_EQUAL(scorer.board(), board);
+        EXPECT_EQUAL(scorer.reset(board), scorer.score());
+    }
+    EXPECT_ERROR(scorer.undo());
+    EXPECT_ERROR(scorer.change(8, 0, 'A'));
+    EXPECT_ERROR(scorer.reset(Grid<char>(9, 9, 'A')));
+}
+
+STUDENT_TEST("generateBoard returns a board with the reported score") {
+    BoggleSolver solver(sharedTrie());
+    AnnealOptions options;
+    options.steps = 2000;
+    options.numChains = 2;
+    GeneratedBoard result = generateBoard(sharedTrie(), options);
+    EXPECT_EQUAL(solver.score(result.board), result.score);
+    EXPECT(result.score > 0);
+    EXPECT(result.evaluations >= 2);
+    EXPECT_EQUAL(result.bestOverTime[result.bestOverTime.size() - 1].second, result.score);
+
+    // 6x6 and up anneal with the incremental scorer
+    options.size = 6;
+    options.steps = 500;
+    result = generateBoard(sharedTrie(), options);
+    EXPECT_EQUAL(solver.score(result.board), result.score);
+    EXPECT_EQUAL(result.board.numRows(), 6);
+    options.size = 4;
+
+    options.minScore = 40;
+    options.maxScore = 60;
+    options.steps = 20000;
+    result = generateBoard(sharedTrie(), options);
+    EXPECT(result.score >= 40 && result.score <= 60);
+    EXPECT_EQUAL(solver.score(result.board), result.score);
+
+    options.numChains = 0;
+    EXPECT_ERROR(generateBoard(sharedTrie(), options));
+}
+
+STUDENT_TEST("Time score evaluations: full rescore versus incremental, and annealing") {
+    BoggleSolver solver(sharedTrie());
+    IncrementalScorer scorer(sharedTrie());
+    for (int size : {4, 5, 6}) {
+        Grid<char> board(size, size, 'E');
+        scorer.reset(board);
+        TIME_OPERATION(size, changeAndRescore(solver, board, 10000));
+        TIME_OPERATION(size, changeIncrementally(scorer, 10000));
+    }
+
+    AnnealOptions options;
+    options.steps = 50000;
+    options.numChains = max(2, (int) thread::hardware_concurrency());
+    GeneratedBoard result = generateBoard(sharedTrie(), options);
+    cout << options.numChains << " chains: best score " << result.score << ", "
+         << result.evaluations / result.seconds << " evaluations/sec" << endl;
+    cout << result.board << endl;
+    cout << "best score over time (seconds, score):";
+    for (const pair<double, int>& point : result.bestOverTime) {
+        cout << " (" << point.first << ", " << point.second << ")";
+    }
+    cout << endl;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "bogglesolver.h"
+#include "grid.h"
+#include "vector.h"
+
+/*
+ * Boggle score of one board that is kept up to date as single cubes change.
+ * It counts, for every word, how many paths on the board spell it; a word
+ * scores while its count is positive. Changing a cube only affects paths
+ * through that cube, so change() walks just those paths, uncounting them with
+ * the old letter and counting them with the new one. Paths that do not yet
+ * include the cube are abandoned as soon as no word they could still become
+ * is long enough to reach it or uses its letter. The counts a change modifies
+ * are logged, so undo() takes a rejected change back without walking the
+ * board. Boards of up to 64 cubes are supported.
+ */
+class IncrementalScorer {
+public:
+    IncrementalScorer(const WordTrie& trie);
+
+    int reset(const Grid<char>& board);
+    int change(int row, int col, char letter);
+    void undo();
+
+    int score() const { return total; }
+    const Grid<char>& board() const { return cubes; }
+    long long evaluations() const { return numEvaluations; }
+
+private:
+    void walk(int cell, int node, uint64_t visited, int length, int delta);
+
+    const WordTrie& trie;
+    std::vector<uint8_t> height;        // per trie node, the most letters any word adds below it
+    std::vector<uint32_t> lettersBelow; // per trie node, a mask of the letters used below it
+    std::vector<int> pathCount;         // per trie node, the paths on the board spelling it
+    Grid<char> cubes;
+    int rows;
+    int cols;
+    std::vector<int8_t> letters;
+    std::vector<uint8_t> neighbors;     // 8 per cell, first numNeighbors[cell] used
+    std::vector<uint8_t> numNeighbors;
+    int total;
+    long long numEvaluations;
+
+    // the cube being changed, and its letter before and after
+    int target;
+    int8_t oldLetter;
+    int8_t newLetter;
+    uint32_t targetLetters;             // mask of oldLetter and newLetter
+
+    // what undo() needs to take back the last change
+    std::vector<std::pair<int, int>> undoLog;
+    int undoCell;
+    char undoLetter;
+    int undoTotal;
+};
+
+/*
+ * Settings for generateBoard. A chain of simulated annealing starts from a
+ * random board and proposes one random cube change per step, accepting it if
+ * the objective does not drop or otherwise with probability exp(delta / T),
+ * where the temperature T falls geometrically from startTemperature to
+ * endTemperature. The objective is the score, or with a target range set
+ * (maxScore > 0), minus the distance from the range.
+ */
+struct AnnealOptions {
+    int size = 4;
+    int steps = 20000;
+    int numChains = 4;
+    double startTemperature = 10;
+    double endTemperature = 0.2;
+    int minScore = 0;
+    int maxScore = 0;
+};
+
+/*
+ * The best board found by generateBoard, the work done, and the best score
+ * reached over time: pairs of (seconds since start, best score so far) from
+ * every chain, merged in time order
+ */
+struct GeneratedBoard {
+    Grid<char> board;
+    int score = 0;
+    long long evaluations = 0;
+    double seconds = 0;
+    Vector<std::pair<double, int>> bestOverTime;
+};
+
+GeneratedBoard generateBoard(const WordTrie& trie, const AnnealOptions& options);
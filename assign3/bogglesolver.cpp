@@ -0,0 +1,630 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include "bogglesolver.h"
+#include "backtracking.h"
+#include "error.h"
+#include "filelib.h"
+#include "grid.h"
+#include "lexicon.h"
+#include "random.h"
+#include "set.h"
+#include "testing/SimpleTest.h"
+using namespace std;
+
+/* * * * * * WordTrie * * * * * */
+
+/*
+ * Lower-case <word> in place
+ * @return false if <word> is empty or has a character other than a letter
+ */
+static bool normalizeWord(string& word) {
+    if (word.empty()) {
+        return false;
+    }
+    for (char& ch : word) {
+        if (!isalpha((unsigned char) ch)) {
+            return false;
+        }
+        ch = tolower(ch);
+    }
+    return true;
+}
+
+/*
+ * Build the trie from a word list file with one word per line
+ */
+WordTrie::WordTrie(string filename) {
+    ifstream in;
+    if (!openFile(in, filename)) {
+        error("Cannot open file named " + filename);
+    }
+    vector<string> words;
+    string word;
+    while (getline(in, word)) {
+        if (!word.empty() && word[word.size() - 1] == '\r') {
+            word.resize(word.size() - 1);
+        }
+        if (normalizeWord(word)) {
+            words.push_back(word);
+        }
+    }
+    build(words);
+}
+
+WordTrie::WordTrie(const Vector<string>& list) {
+    vector<string> words;
+    for (string word : list) {
+        if (normalizeWord(word)) {
+            words.push_back(word);
+        }
+    }
+    build(words);
+}
+
+void WordTrie::build(vector<string>& words) {
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+    wordCount = words.size();
+    nodes.push_back({0, 0});
+    if (!words.empty()) {
+        buildNode(kRoot, words, 0, words.size(), 0);
+    }
+    nodes.shrink_to_fit();
+}
+
+/*
+ * Fill in <node>, whose words are the sorted range words[lo, hi) sharing their
+ * first <depth> letters. Its children are appended as one block before any of
+ * them is filled in, which keeps every sibling group contiguous and puts a
+ * node's children close to it in memory.
+ */
+void WordTrie::buildNode(int node, const vector<string>& words, int lo, int hi, int depth) {
+    uint32_t mask = 0;
+    if ((int) words[lo].size() == depth) {
+        mask |= kWordBit;       // the prefix itself sorts first
+        lo++;
+    }
+    int bounds[27];
+    int numChildren = 0;
+    for (int i = lo; i < hi; i++) {
+        int letter = words[i][depth] - 'a';
+        if (!(mask & (1u << letter))) {
+            mask |= 1u << letter;
+            bounds[numChildren++] = i;
+        }
+    }
+    bounds[numChildren] = hi;
+
+    int first = nodes.size();
+    nodes[node].mask = mask;
+    nodes[node].firstChild = first;
+    nodes.resize(first + numChildren, {0, 0});
+    for (int i = 0; i < numChildren; i++) {
+        buildNode(first + i, words, bounds[i], bounds[i + 1], depth + 1);
+    }
+}
+
+long long WordTrie::memoryUsage() const {
+    return sizeof(*this) + nodes.capacity() * sizeof(Node);
+}
+
+
+/* * * * * * BoggleSolver * * * * * */
+
+BoggleSolver::BoggleSolver(const WordTrie& trie)
+    : trie(trie), rows(0), cols(0), foundIn(trie.numNodes(), 0), epoch(0) {
+}
+
+/*
+ * Load the letters of <board>, rebuilding the neighbor table only when the
+ * board size differs from the previous board
+ */
+void BoggleSolver::setBoard(const Grid<char>& board) {
+    if (board.numRows() * board.numCols() > kMaxCubes) {
+        error("BoggleSolver supports boards of at most 256 cubes");
+    }
+    if (board.numRows() != rows || board.numCols() != cols) {
+        rows = board.numRows();
+        cols = board.numCols();
+        letters.assign(rows * cols, -1);
+        neighbors.assign(8 * rows * cols, 0);
+        numNeighbors.assign(rows * cols, 0);
+        for (int r = 0; r < rows; r++) {
+            for (int c = 0; c < cols; c++) {
+                int cell = r * cols + c;
+                for (int dr = -1; dr <= 1; dr++) {
+                    for (int dc = -1; dc <= 1; dc++) {
+                        if ((dr != 0 || dc != 0) && board.inBounds(r + dr, c + dc)) {
+                            neighbors[8 * cell + numNeighbors[cell]++] = (r + dr) * cols + c + dc;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < cols; c++) {
+            char ch = toupper(board[r][c]);
+            letters[r * cols + c] = (ch >= 'A' && ch <= 'Z') ? ch - 'A' : -1;
+        }
+    }
+}
+
+/*
+ * Start the next board's epoch, clearing the stamps only when the epoch
+ * counter wraps around after 2^32 boards
+ */
+void BoggleSolver::nextEpoch() {
+    if (++epoch == 0) {
+        fill(foundIn.begin(), foundIn.end(), 0);
+        epoch = 1;
+    }
+}
+
+/*
+ * Find every word on a path starting at cube <start>, with a visited bitset
+ * of <Words> 64-bit words. The stack holds one frame per cube on the current
+ * path: the cube, the trie node its letter leads to, and which neighbor to
+ * try next. A neighbor is pushed only if it is unvisited and its letter
+ * continues a word, so every path on the stack spells a prefix.
+ */
+template <int Words>
+void BoggleSolver::searchFrom(int start, Found& found) const {
+    struct Frame {
+        int cell;
+        int node;
+        int next;
+    };
+    Frame stack[kMaxCubes];
+    char word[kMaxCubes];
+    uint64_t visited[Words] = {};
+
+    if (letters[start] < 0 || trie.child(WordTrie::kRoot, letters[start]) < 0) {
+        return;
+    }
+    int depth = 0;
+    stack[0] = {start, trie.child(WordTrie::kRoot, letters[start]), 0};
+    word[0] = 'A' + letters[start];
+    visited[start >> 6] |= uint64_t(1) << (start & 63);
+
+    while (depth >= 0) {
+        Frame& top = stack[depth];
+        if (top.next == numNeighbors[top.cell]) {
+            visited[top.cell >> 6] &= ~(uint64_t(1) << (top.cell & 63));
+            depth--;
+            continue;
+        }
+        int cell = neighbors[8 * top.cell + top.next++];
+        if ((visited[cell >> 6] >> (cell & 63)) & 1 || letters[cell] < 0) {
+            continue;
+        }
+        int node = trie.child(top.node, letters[cell]);
+        if (node < 0) {
+            continue;
+        }
+        stack[++depth] = {cell, node, 0};
+        word[depth] = 'A' + letters[cell];
+        visited[cell >> 6] |= uint64_t(1) << (cell & 63);
+
+        int length = depth + 1;
+        if (length >= 4 && trie.isWord(node) && found.stamps[node] != found.epoch) {
+            found.stamps[node] = found.epoch;
+            found.total += length - 3;
+            if (found.words != nullptr) {
+                found.words->add(string(word, length));
+            }
+            if (found.nodes != nullptr) {
+                found.nodes->push_back({node, length - 3});
+            }
+        }
+    }
+}
+
+/*
+ * Search from cube <start> with the smallest bitset that covers the board
+ */
+void BoggleSolver::searchFrom(int start, Found& found) const {
+    int cubes = rows * cols;
+    if (cubes <= 64) {
+        searchFrom<1>(start, found);
+    } else if (cubes <= 128) {
+        searchFrom<2>(start, found);
+    } else {
+        searchFrom<4>(start, found);
+    }
+}
+
+/*
+ * Score a board by the same rules as scoreBoard: every distinct word of 4 or
+ * more letters formed by a path of adjacent cubes, each used once, scores its
+ * length minus 3.
+ *
+ * @param words If not null, the words found are added to it in upper case
+ * @return The total score of the board
+ */
+int BoggleSolver::score(const Grid<char>& board, Vector<string>* words) {
+    setBoard(board);
+    nextEpoch();
+    Found found = {foundIn.data(), epoch, 0, words, nullptr};
+    for (int cell = 0; cell < rows * cols; cell++) {
+        searchFrom(cell, found);
+    }
+    return found.total;
+}
+
+/*
+ * Score one large board on <numThreads> threads, which take starting cubes
+ * from a shared counter. Each thread de-duplicates the words it finds with
+ * stamps of its own, and the lists of trie nodes found are merged afterwards
+ * so a word found from two starting cubes still counts once.
+ *
+ * @param words If not null, the words found are added to it in upper case,
+ *              in no particular order
+ * @return The total score of the board, the same as score()
+ */
+int BoggleSolver::scoreParallel(const Grid<char>& board, int numThreads, Vector<string>* words) {
+    if (numThreads < 1) {
+        error("scoreParallel needs at least one thread");
+    }
+    setBoard(board);
+    vector<vector<pair<int, int>>> nodes(numThreads);
+    vector<Vector<string>> threadWords(numThreads);
+    atomic<int> nextCell(0);
+
+    auto work = [&](int id) {
+        vector<uint32_t> stamps(trie.numNodes(), 0);
+        Found found = {stamps.data(), 1, 0, words ? &threadWords[id] : nullptr, &nodes[id]};
+        for (int cell = nextCell++; cell < rows * cols; cell = nextCell++) {
+            searchFrom(cell, found);
+        }
+    };
+    vector<thread> threads;
+    for (int id = 1; id < numThreads; id++) {
+        threads.emplace_back(work, id);
+    }
+    work(0);
+    for (thread& t : threads) {
+        t.join();
+    }
+
+    nextEpoch();
+    int total = 0;
+    for (int id = 0; id < numThreads; id++) {
+        for (int i = 0; i < (int) nodes[id].size(); i++) {
+            int node = nodes[id][i].first;
+            if (foundIn[node] != epoch) {
+                foundIn[node] = epoch;
+                total += nodes[id][i].second;
+                if (words != nullptr) {
+                    words->add(threadWords[id][i]);
+                }
+            }
+        }
+    }
+    return total;
+}
+
+/* * * * * * BoggleScorer * * * * * */
+
+BoggleScorer::BoggleScorer(const WordTrie& trie, int numThreads)
+    : trie(trie), boards(nullptr), scores(nullptr), nextBoard(0),
+      generation(0), busyWorkers(0), stopping(false) {
+    if (numThreads < 1) {
+        error("BoggleScorer needs at least one thread");
+    }
+    for (int i = 0; i < numThreads; i++) {
+        workers.emplace_back(&BoggleScorer::workerLoop, this);
+    }
+}
+
+BoggleScorer::~BoggleScorer() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    batchReady.notify_all();
+    for (thread& worker : workers) {
+        worker.join();
+    }
+}
+
+/*
+ * Each worker waits for a new batch, then scores boards until the shared
+ * counter runs past the end of the batch
+ */
+void BoggleScorer::workerLoop() {
+    BoggleSolver solver(trie);
+    int seen = 0;
+    while (true) {
+        unique_lock<mutex> guard(lock);
+        batchReady.wait(guard, [this, seen] { return stopping || generation != seen; });
+        if (stopping) {
+            return;
+        }
+        seen = generation;
+        const Vector<Grid<char>>& batch = *boards;
+        Vector<int>& results = *scores;
+        guard.unlock();
+
+        for (int i = nextBoard++; i < batch.size(); i = nextBoard++) {
+            int score = solver.score(batch[i]);
+            results[i] = score;
+            if (onScore) {
+                lock_guard<mutex> report(reportLock);
+                onScore(i, score);
+            }
+        }
+
+        guard.lock();
+        if (--busyWorkers == 0) {
+            batchDone.notify_all();
+        }
+    }
+}
+
+/*
+ * Score every board on the worker threads
+ *
+ * @param onScore If given, called with the index and score of each board as
+ *                soon as it is scored, in completion order, one call at a time
+ * @return The score of each board, in the same order as <boards>
+ */
+Vector<int> BoggleScorer::scoreAll(const Vector<Grid<char>>& boards, function<void(int, int)> onScore) {
+    lock_guard<mutex> oneBatch(batchLock);
+    Vector<int> results(boards.size(), 0);
+    {
+        lock_guard<mutex> guard(lock);
+        this->boards = &boards;
+        this->scores = &results;
+        this->onScore = onScore;
+        nextBoard = 0;
+        busyWorkers = workers.size();
+        generation++;
+    }
+    batchReady.notify_all();
+
+    unique_lock<mutex> guard(lock);
+    batchDone.wait(guard, [this] { return busyWorkers == 0; });
+    this->boards = nullptr;
+    this->scores = nullptr;
+    this->onScore = nullptr;
+    return results;
+}
+
+
+/* * * * * * Test Cases * * * * * */
+
+/* Test helpers to return shared copies of the word list, loaded once */
+static Lexicon& sharedLexicon() {
+    static Lexicon lex("res/EnglishWords.txt");
+    return lex;
+}
+
+static const WordTrie& sharedTrie() {
+    static WordTrie trie("res/EnglishWords.txt");
+    return trie;
+}
+
+/* Test helper for a random board rolled from the 16 cubes of the 4x4 game.
+ * Larger boards roll a random cube for every cell. */
+static Grid<char> randomBoard(int size = 4) {
+    static const char* cubes[16] = {
+        "AAEEGN", "ABBJOO", "ACHOPS", "AFFKPS", "AOOTTW", "CIMOTU", "DEILRX", "DELRVY",
+        "DISTTY", "EEGHNW", "EEINSU", "EHRTVW", "EIOSST", "ELRTTY", "HIMNQU", "HLNNRZ"
+    };
+    Grid<char> board(size, size);
+    if (size != 4) {
+        for (int r = 0; r < size; r++) {
+            for (int c = 0; c < size; c++) {
+                board[r][c] = cubes[randomInteger(0, 15)][randomInteger(0, 5)];
+            }
+        }
+        return board;
+    }
+    Vector<int> order;
+    for (int i = 0; i < 16; i++) {
+        order.add(i);
+    }
+    for (int i = 0; i < 16; i++) {
+        int pick = randomInteger(i, 15);
+        swap(order[i], order[pick]);
+        board[i / 4][i % 4] = cubes[order[i]][randomInteger(0, 5)];
+    }
+    return board;
+}
+
+/* Test helpers to score every board one way or the other */
+static int scoreAllWithLexicon(Vector<Grid<char>>& boards) {
+    int total = 0;
+    for (Grid<char>& board : boards) {
+        total += scoreBoard(board, sharedLexicon());
+    }
+    return total;
+}
+
+static int scoreAllWithTrie(BoggleSolver& solver, const Vector<Grid<char>>& boards) {
+    int total = 0;
+    for (const Grid<char>& board : boards) {
+        total += solver.score(board);
+    }
+    return total;
+}
+
+STUDENT_TEST("WordTrie holds exactly the words of the word list") {
+    const WordTrie& trie = sharedTrie();
+    EXPECT_EQUAL(trie.numWords(), 127145);
+
+    WordTrie small({"cat", "Cars", "car", "dog", "x-ray", ""});
+    EXPECT_EQUAL(small.numWords(), 4);
+    int c = small.child(WordTrie::kRoot, 'c' - 'a');
+    int ca = small.child(c, 'a' - 'a');
+    int car = small.child(ca, 'r' - 'a');
+    EXPECT(c >= 0 && ca >= 0 && car >= 0);
+    EXPECT(small.isWord(car));
+    EXPECT(!small.isWord(ca));
+    EXPECT(small.isWord(small.child(car, 's' - 'a')));
+    EXPECT(small.isWord(small.child(ca, 't' - 'a')));
+    EXPECT_EQUAL(small.child(ca, 'b' - 'a'), -1);
+    EXPECT_EQUAL(small.child(WordTrie::kRoot, 'x' - 'a'), -1);
+}
+
+STUDENT_TEST("BoggleSolver matches scoreBoard on the provided boards") {
+    BoggleSolver solver(sharedTrie());
+    Grid<char> corner = {{'L','I','_','_'},
+                         {'M','E','_','_'},
+                         {'_','S','_','_'},
+                         {'_','_','_','_'}};
+    Vector<string> words;
+    EXPECT_EQUAL(solver.score(corner, &words), 12);
+    Set<string> expected = {"SMILE", "LIMES", "MILES", "MILE", "MIES", "LIME", "LIES", "ELMS", "SEMI"};
+    Set<string> actual;
+    for (const string& word : words) {
+        actual.add(word);
+    }
+    EXPECT_EQUAL(actual, expected);
+
+    Grid<char> medium = {{'O','T','H','X'},
+                         {'T','H','T','P'},
+                         {'S','S','F','E'},
+                         {'N','A','L','T'}};
+    EXPECT_EQUAL(solver.score(medium), 76);
+    Grid<char> large = {{'E','A','A','R'},
+                        {'L','V','T','S'},
+                        {'R','A','A','N'},
+                        {'O','I','S','E'}};
+    EXPECT_EQUAL(solver.score(large), 234);
+    Grid<char> none = {{'B','C','D','F'},
+                       {'G','H','J','K'},
+                       {'L','M','N','P'},
+                       {'Q','R','S','T'}};
+    EXPECT_EQUAL(solver.score(none), 0);
+}
+
+STUDENT_TEST("BoggleSolver matches scoreBoard on random boards of several sizes") {
+    BoggleSolver solver(sharedTrie());
+    for (int trial = 0; trial < 30; trial++) {
+        Grid<char> board = randomBoard();
+        EXPECT_EQUAL(solver.score(board), scoreBoard(board, sharedLexicon()));
+    }
+    for (int rows = 1; rows <= 8; rows++) {
+        Grid<char> board(rows, 8 - rows + 1);
+        for (int r = 0; r < board.numRows(); r++) {
+            for (int c = 0; c < board.numCols(); c++) {
+                board[r][c] = "EEEAIORSTLNDG"[randomInteger(0, 12)];
+            }
+        }
+        EXPECT_EQUAL(solver.score(board), scoreBoard(board, sharedLexicon()));
+    }
+    EXPECT_ERROR(solver.score(Grid<char>(17, 16, 'A')));
+}
+
+STUDENT_TEST("Time scoring random 4x4 boards: scoreBoard versus BoggleSolver") {
+    sharedLexicon();
+    TIME_OPERATION(127145, WordTrie("res/EnglishWords.txt"));
+    cout << "trie nodes: " << sharedTrie().numNodes()
+         << ", bytes: " << sharedTrie().memoryUsage() << endl;
+
+    Vector<Grid<char>> boards;
+    for (int i = 0; i < 1000; i++) {
+        boards.add(randomBoard());
+    }
+    BoggleSolver solver(sharedTrie());
+    Vector<Grid<char>> few = boards.subList(0, 50);
+    TIME_OPERATION(few.size(), scoreAllWithLexicon(few));
+    TIME_OPERATION(boards.size(), scoreAllWithTrie(solver, boards));
+
+    auto begin = chrono::steady_clock::now();
+    scoreAllWithLexicon(few);
+    double lexiconSeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    begin = chrono::steady_clock::now();
+    scoreAllWithTrie(solver, boards);
+    double trieSeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    cout << "scoreBoard: " << few.size() / lexiconSeconds << " boards/sec, BoggleSolver: "
+         << boards.size() / trieSeconds << " boards/sec" << endl;
+}
+
+STUDENT_TEST("BoggleScorer gives the serial scores and reports every board once") {
+    BoggleSolver solver(sharedTrie());
+    Vector<Grid<char>> boards;
+    Vector<int> expected;
+    for (int i = 0; i < 300; i++) {
+        boards.add(randomBoard());
+        expected.add(solver.score(boards[i]));
+    }
+    for (int threads : {1, 3, 8}) {
+        BoggleScorer scorer(sharedTrie(), threads);
+        Vector<int> reported(boards.size(), -1);
+        int calls = 0;
+        Vector<int> scores = scorer.scoreAll(boards, [&](int index, int score) {
+            reported[index] = score;
+            calls++;
+        });
+        EXPECT_EQUAL(scores, expected);
+        EXPECT_EQUAL(reported, expected);
+        EXPECT_EQUAL(calls, boards.size());
+        EXPECT_EQUAL(scorer.scoreAll(boards), expected);
+        EXPECT_EQUAL(scorer.scoreAll(Vector<Grid<char>>()).size(), 0);
+    }
+    EXPECT_ERROR(BoggleScorer(sharedTrie(), 0));
+}
+
+STUDENT_TEST("Time BoggleScorer boards per second from 1 to N threads") {
+    Vector<Grid<char>> boards;
+    for (int i = 0; i < 20000; i++) {
+        boards.add(randomBoard());
+    }
+    int maxThreads = max(4, (int) thread::hardware_concurrency());
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        BoggleScorer scorer(sharedTrie(), threads);
+        auto begin = chrono::steady_clock::now();
+        Vector<int> scores = scorer.scoreAll(boards);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+        cout << threads << " threads: " << boards.size() / seconds << " boards/sec" << endl;
+    }
+}
+
+STUDENT_TEST("Large boards score the same serially, in parallel and with scoreBoard") {
+    BoggleSolver solver(sharedTrie());
+    for (int size : {6, 9, 12, 16}) {
+        Grid<char> board = randomBoard(size);
+        Vector<string> words, parallelWords;
+        int expected = solver.score(board, &words);
+        if (size <= 9) {
+            EXPECT_EQUAL(expected, scoreBoard(board, sharedLexicon()));
+        }
+        for (int threads : {1, 4}) {
+            parallelWords.clear();
+            EXPECT_EQUAL(solver.scoreParallel(board, threads, &parallelWords), expected);
+            EXPECT_EQUAL(solver.scoreParallel(board, threads), expected);
+            parallelWords.sort();
+            words.sort();
+            EXPECT_EQUAL(parallelWords, words);
+        }
+    }
+    EXPECT_ERROR(solver.scoreParallel(randomBoard(), 0));
+}
+
+/* Test helper to score the same board <rounds> times */
+static int scoreRepeatedly(BoggleSolver& solver, const Grid<char>& board, int rounds, int threads) {
+    int total = 0;
+    for (int i = 0; i < rounds; i++) {
+        total += threads == 0 ? solver.score(board) : solver.scoreParallel(board, threads);
+    }
+    return total;
+}
+
+STUDENT_TEST("Time scoring boards from 4x4 up to 16x16") {
+    sharedLexicon();
+    BoggleSolver solver(sharedTrie());
+    int maxThreads = max(4, (int) thread::hardware_concurrency());
+    for (int size : {4, 6, 8, 10, 12, 16}) {
+        Grid<char> board = randomBoard(size);
+        if (size <= 10) {
+            TIME_OPERATION(size, scoreBoard(board, sharedLexicon()));
+        }
+        TIME_OPERATION(size, scoreRepeatedly(solver, board, 10, 0));
+        TIME_OPERATION(size, scoreRepeatedly(solver, board, 10, maxThreads));
+    }
+}
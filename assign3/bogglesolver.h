@@ -0,0 +1,153 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "grid.h"
+#include "vector.h"
+
+/*
+ * Read-only trie over the letters A-Z stored in one flat array of 8-byte
+ * nodes. A node holds a 26-bit mask of the letters that have a child, a flag
+ * for "a word ends here", and the index of its first child; the children of a
+ * node sit next to each other in letter order, so the child for a letter is
+ * found by counting the mask bits below it. Advancing one letter is O(1) and
+ * allocates nothing. Words are case-insensitive; words containing anything
+ * other than letters are skipped.
+ */
+class WordTrie {
+public:
+    static const int kRoot = 0;
+
+    WordTrie(std::string filename);
+    WordTrie(const Vector<std::string>& words);
+
+    /*
+     * @return The child of <node> for <letter> (0 for A through 25 for Z),
+     *         or -1 if no word continues that way
+     */
+    int child(int node, int letter) const {
+        uint32_t mask = nodes[node].mask;
+        uint32_t bit = 1u << letter;
+        if (!(mask & bit)) {
+            return -1;
+        }
+        return nodes[node].firstChild + __builtin_popcount(mask & (bit - 1));
+    }
+
+    bool isWord(int node) const { return nodes[node].mask & kWordBit; }
+    int numNodes() const { return nodes.size(); }
+    int numWords() const { return wordCount; }
+    long long memoryUsage() const;
+
+private:
+    static const uint32_t kWordBit = 1u << 31;
+
+    struct Node {
+        uint32_t mask;          // bit i set if letter i has a child, plus kWordBit
+        uint32_t firstChild;
+    };
+
+    void build(std::vector<std::string>& words);
+    void buildNode(int node, const std::vector<std::string>& words, int lo, int hi, int depth);
+
+    std::vector<Node> nodes;
+    int wordCount;
+};
+
+/*
+ * Boggle scorer that walks a WordTrie one node per letter. Boards of up to 256
+ * cubes (16x16) are searched depth-first with an explicit stack, the visited
+ * cubes held in a bitset of 64, 128 or 256 bits chosen by the board size, and
+ * the neighbors of every cube looked up in a table built once per board size.
+ * A path is only extended while the trie has a word continuing it, so the
+ * search never leaves the prefixes of real words however large the board.
+ *
+ * A solver keeps its scratch space between boards, so scoring many boards of
+ * one size allocates nothing; it is not safe to share one solver between
+ * threads, but any number of solvers may share a trie.
+ *
+ * Words are de-duplicated by the trie node they end at: the node is stamped
+ * with the number of the current board, so a word counts once per board and
+ * starting a new board is just incrementing that number.
+ */
+class BoggleSolver {
+public:
+    static const int kMaxCubes = 256;
+
+    BoggleSolver(const WordTrie& trie);
+
+    int score(const Grid<char>& board, Vector<std::string>* words = nullptr);
+    int scoreParallel(const Grid<char>& board, int numThreads, Vector<std::string>* words = nullptr);
+
+private:
+    /*
+     * Where one search records its words: <stamps> marks the trie nodes found
+     * in the current <epoch>, and each new word's points are added to <total>
+     * and, if not null, the word to <words> and its node and points to <nodes>
+     */
+    struct Found {
+        uint32_t* stamps;
+        uint32_t epoch;
+        int total;
+        Vector<std::string>* words;
+        std::vector<std::pair<int, int>>* nodes;
+    };
+
+    void setBoard(const Grid<char>& board);
+    void nextEpoch();
+    void searchFrom(int start, Found& found) const;
+    template <int Words>
+    void searchFrom(int start, Found& found) const;
+
+    const WordTrie& trie;
+    int rows;
+    int cols;
+    std::vector<int8_t> letters;        // letter of each cube, -1 if not A-Z
+    std::vector<uint8_t> neighbors;     // 8 per cell, first numNeighbors[cell] used
+    std::vector<uint8_t> numNeighbors;
+    std::vector<uint32_t> foundIn;      // per trie node, the epoch of the last board that found it
+    uint32_t epoch;                     // bumped per board, so nothing is cleared between boards
+};
+
+/*
+ * Pool of worker threads that score batches of boards, each worker with its
+ * own BoggleSolver over one shared read-only trie. Workers take boards one at
+ * a time from a shared counter, so uneven boards balance themselves, and each
+ * score is reported as soon as it is known.
+ */
+class BoggleScorer {
+public:
+    BoggleScorer(const WordTrie& trie, int numThreads);
+    ~BoggleScorer();
+
+    Vector<int> scoreAll(const Vector<Grid<char>>& boards,
+                         std::function<void(int index, int score)> onScore = nullptr);
+
+    int numThreads() const { return workers.size(); }
+
+private:
+    void workerLoop();
+
+    const WordTrie& trie;
+    std::vector<std::thread> workers;
+    std::mutex lock;
+    std::condition_variable batchReady;
+    std::condition_variable batchDone;
+    std::mutex reportLock;
+    std::mutex batchLock;               // one batch at a time
+
+    // the current batch, guarded by lock except for the atomic counter
+    const Vector<Grid<char>>* boards;
+    Vector<int>* scores;
+    std::function<void(int, int)> onScore;
+    std::atomic<int> nextBoard;
+    int generation;
+    int busyWorkers;
+    bool stopping;
+};
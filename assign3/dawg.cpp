@@ -0,0 +1,438 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "dawg.h"
+#include "error.h"
+#include "filelib.h"
+#include "lexicon.h"
+#include "random.h"
+#include "testing/SimpleTest.h"
+using namespace std;
+
+/* * * * * * Mapped image * * * * * */
+
+/*
+ * Read-only memory mapping of a whole file, unmapped when destroyed
+ */
+class MappedImage {
+public:
+    MappedImage(const string& filename);
+    ~MappedImage();
+
+    const uint8_t* data() const { return base; }
+    size_t size() const { return length; }
+
+private:
+    const uint8_t* base;
+    size_t length;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE view;
+#endif
+};
+
+#ifdef _WIN32
+MappedImage::MappedImage(const string& filename) : base(nullptr), length(0), view(nullptr) {
+    file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    // error() throws, so the destructor will not run: close what is open first
+    LARGE_INTEGER size;
+    if (file == INVALID_HANDLE_VALUE) {
+        error("Cannot open file named " + filename);
+    }
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        error("Cannot open file named " + filename);
+    }
+    length = size.QuadPart;
+    if (length > 0) {
+        view = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        base = view ? (const uint8_t*) MapViewOfFile(view, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (base == nullptr) {
+            if (view != nullptr) CloseHandle(view);
+            CloseHandle(file);
+            error("Cannot map file named " + filename);
+        }
+    }
+}
+
+MappedImage::~MappedImage() {
+    if (base != nullptr) UnmapViewOfFile(base);
+    if (view != nullptr) CloseHandle(view);
+    CloseHandle(file);
+}
+#else
+MappedImage::MappedImage(const string& filename) : base(nullptr), length(0) {
+    // error() throws, so the destructor will not run: close what is open first
+    int fd = open(filename.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0) {
+        error("Cannot open file named " + filename);
+    }
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        error("Cannot open file named " + filename);
+    }
+    length = info.st_size;
+    if (length > 0) {
+        void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            close(fd);
+            error("Cannot map file named " + filename);
+        }
+        base = (const uint8_t*) address;
+    }
+    close(fd);
+}
+
+MappedImage::~MappedImage() {
+    if (base != nullptr) {
+        munmap((void*) base, length);
+    }
+}
+#endif
+
+
+/* * * * * * Compiling * * * * * */
+
+/*
+ * An image is a 16-byte header followed by the node array:
+ *   bytes 0-3    magic "DWG1"
+ *   bytes 4-7    number of nodes
+ *   bytes 8-11   number of words
+ *   bytes 12-15  kByteOrder, to reject an image written on a machine of the
+ *                other endianness
+ * and then two uint32 per node, mask and first child, in native byte order.
+ * Node 0 is the root.
+ */
+const char kMagic[4] = {'D', 'W', 'G', '1'};
+const int kHeaderSize = 16;
+const uint32_t kByteOrder = 0x01020304;
+
+/*
+ * Builds the node array bottom-up. The node for a range of words is computed
+ * after its children, and the children's block of nodes is looked up by
+ * content: a block already emitted for an equal set of suffixes is reused
+ * rather than appended again. Equal subtrees therefore end up as one block,
+ * which is what minimizes the trie into a DAWG.
+ */
+class DawgBuilder {
+public:
+    DawgBuilder(const vector<string>& words) : words(words) {
+        nodes.assign(2, 0);     // reserve the root
+    }
+
+    void build() {
+        if (!words.empty()) {
+            pair<uint32_t, uint32_t> root = buildNode(0, words.size(), 0);
+            nodes[0] = root.first;
+            nodes[1] = root.second;
+        }
+    }
+
+    vector<uint32_t> nodes;
+
+private:
+    pair<uint32_t, uint32_t> buildNode(int lo, int hi, int depth) {
+        uint32_t mask = 0;
+        if ((int) words[lo].size() == depth) {
+            mask |= 1u << 31;       // the prefix itself sorts first
+            lo++;
+        }
+        vector<uint32_t> block;
+        while (lo < hi) {
+            char letter = words[lo][depth];
+            int end = lo;
+            while (end < hi && words[end][depth] == letter) {
+                end++;
+            }
+            mask |= 1u << (letter - 'a');
+            pair<uint32_t, uint32_t> child = buildNode(lo, end, depth + 1);
+            block.push_back(child.first);
+            block.push_back(child.second);
+            lo = end;
+        }
+        if (block.empty()) {
+            return {mask, 0};
+        }
+
+        string key((const char*) block.data(), block.size() * sizeof(uint32_t));
+        auto found = blocks.find(key);
+        if (found != blocks.end()) {
+            return {mask, found->second};
+        }
+        uint32_t first = nodes.size() / 2;
+        nodes.insert(nodes.end(), block.begin(), block.end());
+        blocks[key] = first;
+        return {mask, first};
+    }
+
+    const vector<string>& words;
+    unordered_map<string, uint32_t> blocks;
+};
+
+/*
+ * Compile a word list with one word per line into a DAWG image. Words are
+ * case-insensitive; words containing anything other than letters are skipped.
+ */
+void Dawg::compile(string wordFile, string imageFile) {
+    ifstream in;
+    if (!openFile(in, wordFile)) {
+        error("Cannot open file named " + wordFile);
+    }
+    vector<string> words;
+    string word;
+    while (getline(in, word)) {
+        if (!word.empty() && word[word.size() - 1] == '\r') {
+            word.resize(word.size() - 1);
+        }
+        bool letters = !word.empty();
+        for (char& ch : word) {
+            letters = letters && isalpha((unsigned char) ch);
+            ch = tolower(ch);
+        }
+        if (letters) {
+            words.push_back(word);
+        }
+    }
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+
+    DawgBuilder builder(words);
+    builder.build();
+    uint32_t header[4];
+    memcpy(header, kMagic, 4);
+    header[1] = builder.nodes.size() / 2;
+    header[2] = words.size();
+    header[3] = kByteOrder;
+
+    ofstream out(imageFile, ios::binary);
+    if (!out) {
+        error("Cannot open file named " + imageFile);
+    }
+    out.write((const char*) header, kHeaderSize);
+    out.write((const char*) builder.nodes.data(), builder.nodes.size() * sizeof(uint32_t));
+    if (!out) {
+        error("Cannot write file named " + imageFile);
+    }
+}
+
+
+/* * * * * * Lookups * * * * * */
+
+/*
+ * Map a compiled image. The node array is used straight from the mapping, after
+ * one pass checking that every node's children lie inside it, so that child()
+ * and forEachChild never read past the mapping even for a damaged image.
+ */
+Dawg::Dawg(string imageFile) {
+    image = make_shared<MappedImage>(imageFile);
+    const uint8_t* base = image->data();
+    if (image->size() < (size_t) kHeaderSize || memcmp(base, kMagic, 4) != 0) {
+        error(imageFile + " is not a DAWG image");
+    }
+    const uint32_t* header = (const uint32_t*) base;
+    if (header[3] != kByteOrder) {
+        error(imageFile + " was compiled with the other byte order");
+    }
+    nodeCount = header[1];
+    wordCount = header[2];
+    if (nodeCount < 1 || image->size() != kHeaderSize + (size_t) nodeCount * 2 * sizeof(uint32_t)) {
+        error(imageFile + " is truncated");
+    }
+    nodes = header + kHeaderSize / sizeof(uint32_t);
+    for (int node = 0; node < nodeCount; node++) {
+        uint32_t mask = nodes[2 * node] & ~kWordBit;
+        uint64_t childrenEnd = nodes[2 * node + 1] + (uint64_t) __builtin_popcount(mask);
+        if ((mask >> 26) != 0 || childrenEnd > (uint64_t) nodeCount) {
+            error(imageFile + " is damaged");
+        }
+    }
+}
+
+/*
+ * Follow <letters> from the root, in either case
+ * @return The node reached, or -1 if no word starts with <letters>
+ */
+int Dawg::walk(const string& letters) const {
+    int node = kRoot;
+    for (char ch : letters) {
+        int letter = tolower((unsigned char) ch) - 'a';
+        if (letter < 0 || letter >= 26) {
+            return -1;
+        }
+        node = child(node, letter);
+        if (node < 0) {
+            return -1;
+        }
+    }
+    return node;
+}
+
+bool Dawg::contains(const string& word) const {
+    int node = walk(word);
+    return node >= 0 && isWord(node);
+}
+
+bool Dawg::containsPrefix(const string& prefix) const {
+    return walk(prefix) >= 0;
+}
+
+
+/* * * * * * Test Cases * * * * * */
+
+/* Test helpers to return shared copies of the word list and its image, built once */
+static Lexicon& sharedLexicon() {
+    static Lexicon lex("res/EnglishWords.txt");
+    return lex;
+}
+
+static string sharedImage() {
+    static string image;
+    if (image.empty()) {
+        image = getTempDirectory() + "/EnglishWords.dawg";
+        Dawg::compile("res/EnglishWords.txt", image);
+    }
+    return image;
+}
+
+/* Test helper to collect every word below <node> with child iteration */
+static void collectWords(const Dawg& dawg, int node, string& prefix, Vector<string>& words) {
+    if (dawg.isWord(node)) {
+        words.add(prefix);
+    }
+    dawg.forEachChild(node, [&](int letter, int next) {
+        prefix += (char) ('a' + letter);
+        collectWords(dawg, next, prefix, words);
+        prefix.pop_back();
+    });
+}
+
+/* Test helper for a random lower-case string */
+static string randomLetters(int length) {
+    string result;
+    for (int i = 0; i < length; i++) {
+        result += (char) ('a' + randomInteger(0, 25));
+    }
+    return result;
+}
+
+/* Test helpers to look up every word in a list */
+static int countContained(const Lexicon& lex, const Vector<string>& words) {
+    int count = 0;
+    for (const string& word : words) {
+        count += lex.contains(word);
+    }
+    return count;
+}
+
+static int countContained(const Dawg& dawg, const Vector<string>& words) {
+    int count = 0;
+    for (const string& word : words) {
+        count += dawg.contains(word);
+    }
+    return count;
+}
+
+STUDENT_TEST("Dawg enumerates exactly the words of the word list, in order") {
+    Dawg dawg(sharedImage());
+    EXPECT_EQUAL(dawg.numWords(), sharedLexicon().size());
+    Vector<string> words;
+    string prefix;
+    collectWords(dawg, Dawg::kRoot, prefix, words);
+    EXPECT_EQUAL(words.size(), sharedLexicon().size());
+    int i = 0;
+    for (const string& word : sharedLexicon()) {
+        if (i < words.size() && words[i] != word) {
+            EXPECT_EQUAL(words[i], word);
+            break;
+        }
+        i++;
+    }
+}
+
+STUDENT_TEST("Dawg contains and containsPrefix agree with Lexicon") {
+    Dawg dawg(sharedImage());
+    const Lexicon& lex = sharedLexicon();
+    EXPECT(dawg.contains("Zygote"));
+    EXPECT(dawg.containsPrefix("ZYG"));
+    EXPECT(dawg.containsPrefix(""));
+    EXPECT(!dawg.contains(""));
+    EXPECT(!dawg.contains("x-ray"));
+    for (int trial = 0; trial < 20000; trial++) {
+        string word = randomLetters(randomInteger(1, 6));
+        EXPECT_EQUAL(dawg.contains(word), lex.contains(word));
+        EXPECT_EQUAL(dawg.containsPrefix(word), lex.containsPrefix(word));
+    }
+}
+
+STUDENT_TEST("Dawg image rejects missing and damaged files") {
+    EXPECT_ERROR(Dawg(getTempDirectory() + "/missing.dawg"));
+    EXPECT_ERROR(Dawg("res/EnglishWords.txt"));
+    string truncated = getTempDirectory() + "/truncated.dawg";
+    {
+        ifstream in(sharedImage(), ios::binary);
+        string bytes(100, '\0');
+        in.read(&bytes[0], bytes.size());
+        ofstream out(truncated, ios::binary);
+        out.write(bytes.data(), bytes.size());
+    }
+    EXPECT_ERROR(Dawg(truncated));
+    deleteFile(truncated);
+
+    // right length, but the root's first child points past the last node
+    string damaged = getTempDirectory() + "/damaged.dawg";
+    {
+        ifstream in(sharedImage(), ios::binary);
+        string bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        uint32_t numNodes;
+        memcpy(&numNodes, &bytes[4], sizeof(numNodes));
+        memcpy(&bytes[kHeaderSize + sizeof(uint32_t)], &numNodes, sizeof(numNodes));
+        ofstream out(damaged, ios::binary);
+        out.write(bytes.data(), bytes.size());
+    }
+    EXPECT_ERROR(Dawg(damaged));
+    deleteFile(damaged);
+}
+
+STUDENT_TEST("Time building, loading and looking up: Lexicon versus Dawg") {
+    string image = getTempDirectory() + "/bench.dawg";
+    TIME_OPERATION(127145, Lexicon("res/EnglishWords.txt"));
+    TIME_OPERATION(127145, Dawg::compile("res/EnglishWords.txt", image));
+    TIME_OPERATION(127145, Dawg(image));
+    Dawg dawg(image);
+    ifstream in(image, ios::binary | ios::ate);
+    cout << "image: " << dawg.numNodes() << " nodes, " << in.tellg() << " bytes" << endl;
+
+    Vector<string> words;
+    for (const string& word : sharedLexicon()) {
+        words.add(word);
+    }
+    for (int i = 0; i < 127145; i++) {
+        words.add(randomLetters(randomInteger(3, 8)));
+    }
+    // print the counts so the lookups cannot be optimized away
+    auto begin = chrono::steady_clock::now();
+    int found = countContained(sharedLexicon(), words);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    cout << "Lexicon lookup: " << seconds / words.size() * 1e9 << " ns per word, " << found << " found" << endl;
+
+    begin = chrono::steady_clock::now();
+    found = countContained(dawg, words);
+    seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    cout << "Dawg lookup: " << seconds / words.size() * 1e9 << " ns per word, " << found << " found" << endl;
+    deleteFile(image);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+class MappedImage;
+
+/*
+ * Read-only word list stored as a minimized DAWG (directed acyclic word
+ * graph): a trie in which equal suffix subtrees are stored once. Nodes have
+ * the same layout as WordTrie, a 26-bit mask of child letters plus a word flag
+ * and the index of the first child, with the children of a node next to each
+ * other in letter order; nodes with equal children share one block.
+ *
+ * compile() writes the node array as a binary image, and the constructor
+ * memory-maps that image and uses it in place, so loading costs only the
+ * mapping and one pass checking the child offsets. Lookups and child
+ * iteration never allocate.
+ */
+class Dawg {
+public:
+    static const int kRoot = 0;
+
+    Dawg(std::string imageFile);
+
+    static void compile(std::string wordFile, std::string imageFile);
+
+    bool contains(const std::string& word) const;
+    bool containsPrefix(const std::string& prefix) const;
+
+    /*
+     * @return The child of <node> for <letter> (0 for A through 25 for Z),
+     *         or -1 if no word continues that way
+     */
+    int child(int node, int letter) const {
+        uint32_t mask = nodes[2 * node];
+        uint32_t bit = 1u << letter;
+        if (!(mask & bit)) {
+            return -1;
+        }
+        return nodes[2 * node + 1] + __builtin_popcount(mask & (bit - 1));
+    }
+
+    bool isWord(int node) const { return nodes[2 * node] & kWordBit; }
+
+    /*
+     * Call fn(letter, child) for every child of <node> in letter order
+     */
+    template <typename Fn>
+    void forEachChild(int node, Fn fn) const {
+        uint32_t mask = nodes[2 * node] & ~kWordBit;
+        int next = nodes[2 * node + 1];
+        while (mask != 0) {
+            fn(__builtin_ctz(mask), next++);
+            mask &= mask - 1;
+        }
+    }
+
+    int numNodes() const { return nodeCount; }
+    int numWords() const { return wordCount; }
+
+private:
+    static const uint32_t kWordBit = 1u << 31;
+
+    int walk(const std::string& letters) const;
+
+    std::shared_ptr<const MappedImage> image;
+    const uint32_t* nodes;      // two words per node: mask, first child
+    int nodeCount;
+    int wordCount;
+};
@@ -0,0 +1,495 @@
+#include <iostream>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "error.h"
+#include "extmerge.h"
+#include "filelib.h"
+#include "random.h"
+#include "testing/SimpleTest.h"
+using namespace std;
+
+static const int kPageBytes = 4096;
+
+/* * * * * * Blocks and the I/O thread * * * * * */
+
+/*
+ * A page-aligned buffer of ints and the state of the I/O on it: <ready> is
+ * false while the I/O thread owns the block, and <count> is the number of
+ * ints it holds
+ */
+class Block {
+public:
+    Block(int capacity) : capacity(capacity), count(0), ready(true) {
+        storage.resize(capacity * sizeof(int) + kPageBytes);
+        uintptr_t address = (uintptr_t) storage.data();
+        data = (int*) ((address + kPageBytes - 1) / kPageBytes * kPageBytes);
+    }
+    Block(const Block&) = delete;
+
+    // moving a vector keeps its buffer, so <data> stays aligned and valid
+    Block(Block&& other)
+        : data(other.data), capacity(other.capacity), count(other.count), ready(other.ready),
+          storage(std::move(other.storage)) {
+        other.data = nullptr;
+    }
+
+    int* data;
+    int capacity;
+    int count;
+    bool ready;
+
+private:
+    vector<char> storage;
+};
+
+/*
+ * One background thread that runs I/O jobs in the order they are submitted,
+ * so the reads of one file and the writes of the output stay sequential. A
+ * job hands its block back by marking it ready; a failed job records an
+ * error that the merge reports the next time it waits.
+ */
+class IoThread {
+public:
+    IoThread() : stopping(false), worker(&IoThread::run, this) {}
+
+    ~IoThread() {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        changed.notify_all();
+        worker.join();
+    }
+
+    /*
+     * Take <block> from the merge and run <job> on it, which returns an error
+     * message or "" on success
+     */
+    void submit(Block& block, function<string()> job) {
+        {
+            lock_guard<mutex> guard(lock);
+            block.ready = false;
+            jobs.push_back([this, &block, job]() {
+                string problem = job();
+                lock_guard<mutex> guard(lock);
+                if (!problem.empty() && failure.empty()) {
+                    failure = problem;
+                }
+                block.ready = true;
+            });
+        }
+        changed.notify_all();
+    }
+
+    /*
+     * Wait until the I/O thread hands <block> back, reporting any failed job
+     */
+    void waitFor(const Block& block) {
+        unique_lock<mutex> guard(lock);
+        changed.wait(guard, [&]() { return block.ready || !failure.empty(); });
+        if (!failure.empty()) {
+            error(failure);
+        }
+    }
+
+    /*
+     * Wait until the I/O thread is done with <block>, failed or not, so the
+     * block can be freed
+     */
+    void release(const Block& block) {
+        unique_lock<mutex> guard(lock);
+        changed.wait(guard, [&]() { return block.ready; });
+    }
+
+private:
+    void run() {
+        while (true) {
+            function<void()> job;
+            {
+                unique_lock<mutex> guard(lock);
+                changed.wait(guard, [this]() { return stopping || !jobs.empty(); });
+                if (jobs.empty()) {
+                    return;
+                }
+                job = jobs.front();
+                jobs.pop_front();
+            }
+            job();
+            changed.notify_all();
+        }
+    }
+
+    mutex lock;
+    condition_variable changed;
+    deque<function<void()>> jobs;
+    string failure;
+    bool stopping;
+    thread worker;
+};
+
+/* * * * * * Readers and writer * * * * * */
+
+/*
+ * Sequential reader of one sorted input file through two blocks, one being
+ * consumed while the I/O thread fills the other
+ */
+class RunReader {
+public:
+    RunReader(const string& filename, int blockInts, IoThread& io)
+        : name(filename), io(io), blocks{Block(blockInts), Block(blockInts)}, current(0), pos(0) {
+        file = fopen(filename.c_str(), "rb");
+        if (file == nullptr) {
+            error("Cannot open file named " + filename);
+        }
+        setvbuf(file, nullptr, _IONBF, 0);
+        fill(blocks[0]);
+        fill(blocks[1]);
+    }
+
+    ~RunReader() {
+        io.release(blocks[0]);
+        io.release(blocks[1]);
+        fclose(file);
+    }
+
+    /*
+     * Wait for the first block, after which head() is valid
+     */
+    void start() {
+        io.waitFor(blocks[0]);
+        key = blocks[0].count > 0 ? blocks[0].data[0] : LLONG_MAX;
+    }
+
+    /*
+     * @return The next int, or LLONG_MAX once the file is used up
+     */
+    long long head() const { return key; }
+
+    /*
+     * Move past the head, refilling the block just emptied and switching to
+     * the prefetched one when the current block runs out
+     */
+    void advance() {
+        Block& block = blocks[current];
+        if (++pos < block.count) {
+            long long next = block.data[pos];
+            if (next < key) {
+                error("Input file " + name + " is not in increasing order");
+            }
+            key = next;
+            return;
+        }
+        if (block.count < block.capacity) {
+            key = LLONG_MAX;            // a short block is the end of the file
+            return;
+        }
+        fill(block);
+        current = 1 - current;
+        pos = 0;
+        io.waitFor(blocks[current]);
+        if (blocks[current].count == 0) {
+            key = LLONG_MAX;
+            return;
+        }
+        long long next = blocks[current].data[0];
+        if (next < key) {
+            error("Input file " + name + " is not in increasing order");
+        }
+        key = next;
+    }
+
+private:
+    void fill(Block& block) {
+        FILE* in = file;
+        string filename = name;
+        io.submit(block, [in, &block, filename]() {
+            size_t bytes = fread(block.data, 1, block.capacity * sizeof(int), in);
+            block.count = bytes / sizeof(int);
+            if (ferror(in)) {
+                return "Cannot read file named " + filename;
+            }
+            if (bytes % sizeof(int) != 0) {
+                return "File " + filename + " is not a whole number of ints";
+            }
+            return string();
+        });
+    }
+
+    string name;
+    IoThread& io;
+    FILE* file;
+    Block blocks[2];
+    int current;
+    int pos;
+    long long key;
+};
+
+/*
+ * Output written in whole aligned blocks by the I/O thread, while the merge
+ * fills the other block
+ */
+class BlockWriter {
+public:
+    BlockWriter(const string& filename, int blockInts, IoThread& io)
+        : name(filename), io(io), blocks{Block(blockInts), Block(blockInts)}, current(0) {
+        file = fopen(filename.c_str(), "wb");
+        if (file == nullptr) {
+            error("Cannot open file named " + filename);
+        }
+        setvbuf(file, nullptr, _IONBF, 0);
+    }
+
+    ~BlockWriter() {
+        io.release(blocks[0]);
+        io.release(blocks[1]);
+        fclose(file);
+    }
+
+    void put(int value) {
+        Block& block = blocks[current];
+        block.data[block.count++] = value;
+        if (block.count == block.capacity) {
+            flush();
+        }
+    }
+
+    /*
+     * Write what is buffered and wait until all of it is on its way to disk
+     */
+    void finish() {
+        if (blocks[current].count > 0) {
+            flush();
+        }
+        io.waitFor(blocks[0]);
+        io.waitFor(blocks[1]);
+        if (fflush(file) != 0) {
+            error("Cannot write file named " + name);
+        }
+    }
+
+private:
+    void flush() {
+        Block& block = blocks[current];
+        FILE* out = file;
+        string filename = name;
+        io.submit(block, [out, &block, filename]() {
+            size_t written = fwrite(block.data, sizeof(int), block.count, out);
+            bool complete = written == (size_t) block.count;
+            block.count = 0;
+            return complete ? string() : "Cannot write file named " + filename;
+        });
+        current = 1 - current;
+        io.waitFor(blocks[current]);
+    }
+
+    string name;
+    IoThread& io;
+    FILE* file;
+    Block blocks[2];
+    int current;
+};
+
+/* * * * * * Merge * * * * * */
+
+long long externalMerge(const Vector<string>& inputFiles, string outputFile, long long memoryBudget) {
+    int k = inputFiles.size();
+    long long blockBytes = memoryBudget / (2 * (k + 1)) / kPageBytes * kPageBytes;
+    if (blockBytes < kPageBytes) {
+        error("A memory budget of " + to_string(memoryBudget) + " bytes is too small to merge "
+              + to_string(k) + " files");
+    }
+    blockBytes = min(blockBytes, (long long) INT_MAX / kPageBytes * kPageBytes);
+    int blockInts = blockBytes / sizeof(int);
+
+    IoThread io;
+    vector<unique_ptr<RunReader>> readers;
+    for (const string& filename : inputFiles) {
+        readers.emplace_back(new RunReader(filename, blockInts, io));
+    }
+    BlockWriter writer(outputFile, blockInts, io);
+    for (auto& reader : readers) {
+        reader->start();
+    }
+
+    // the same loser tree as loserTreeMerge, over copies of the readers' heads
+    vector<long long> key(k);
+    for (int run = 0; run < k; run++) {
+        key[run] = readers[run]->head();
+    }
+    auto beats = [&](int a, int b) {
+        return key[a] < key[b] || (key[a] == key[b] && a < b);
+    };
+    long long written = 0;
+    if (k > 0) {
+        vector<int> loser(k, -1), winner(2 * k);
+        for (int run = 0; run < k; run++) {
+            winner[k + run] = run;
+        }
+        for (int node = k - 1; node >= 1; node--) {
+            int left = winner[2 * node], right = winner[2 * node + 1];
+            bool leftWins = beats(left, right);
+            winner[node] = leftWins ? left : right;
+            loser[node] = leftWins ? right : left;
+        }
+        int champion = k == 1 ? 0 : winner[1];
+        while (key[champion] != LLONG_MAX) {
+            writer.put(key[champion]);
+            written++;
+            readers[champion]->advance();
+            key[champion] = readers[champion]->head();
+            for (int node = (k + champion) / 2; node >= 1; node /= 2) {
+                if (beats(loser[node], champion)) {
+                    swap(loser[node], champion);
+                }
+            }
+        }
+    }
+    writer.finish();
+    return written;
+}
+
+/*
+ * Write <values> to <filename> as raw native-endian ints
+ */
+void writeIntFile(string filename, const Vector<int>& values) {
+    FILE* out = fopen(filename.c_str(), "wb");
+    if (out == nullptr) {
+        error("Cannot open file named " + filename);
+    }
+    size_t written = values.isEmpty() ? 0 : fwrite(&values[0], sizeof(int), values.size(), out);
+    if (fclose(out) != 0 || written != (size_t) values.size()) {
+        error("Cannot write file named " + filename);
+    }
+}
+
+/*
+ * @return The ints stored in <filename> by writeIntFile or externalMerge
+ */
+Vector<int> readIntFile(string filename) {
+    FILE* in = fopen(filename.c_str(), "rb");
+    if (in == nullptr) {
+        error("Cannot open file named " + filename);
+    }
+    Vector<int> values;
+    int buffer[1024];
+    size_t count;
+    while ((count = fread(buffer, sizeof(int), 1024, in)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            values.add(buffer[i]);
+        }
+    }
+    fclose(in);
+    return values;
+}
+
+
+/* * * * * * Test Cases * * * * * */
+
+/* Test helper to write <k> sorted files of random ints, <total> in all, returning their names */
+static Vector<string> writeSortedFiles(int k, int total, Vector<int>& all) {
+    Vector<Vector<int>> runs(k);
+    for (int i = 0; i < total; i++) {
+        int value = randomInteger(INT_MIN, INT_MAX);
+        runs[randomInteger(0, k - 1)].add(value);
+        all.add(value);
+    }
+    Vector<string> files;
+    for (int i = 0; i < k; i++) {
+        runs[i].sort();
+        files.add(getTempDirectory() + "/run" + to_string(i) + ".bin");
+        writeIntFile(files[i], runs[i]);
+    }
+    all.sort();
+    return files;
+}
+
+/* Test helper to delete the files of a test */
+static void deleteFiles(const Vector<string>& files) {
+    for (const string& file : files) {
+        deleteFile(file);
+    }
+}
+
+STUDENT_TEST("externalMerge matches sorting everything in memory") {
+    string output = getTempDirectory() + "/merged.bin";
+    for (int k : {1, 2, 7, 50}) {
+        for (long long budget : {64LL << 20, 2LL * (k + 1) * 4096}) {
+            Vector<int> expected;
+            Vector<string> files = writeSortedFiles(k, 20000, expected);
+            EXPECT_EQUAL(externalMerge(files, output, budget), expected.size());
+            EXPECT_EQUAL(readIntFile(output), expected);
+            deleteFiles(files);
+        }
+    }
+
+    // empty inputs, and no inputs at all
+    Vector<string> files = {getTempDirectory() + "/empty.bin", getTempDirectory() + "/small.bin"};
+    Vector<int> small = {-4, 0, 0, 9};
+    writeIntFile(files[0], {});
+    writeIntFile(files[1], small);
+    EXPECT_EQUAL(externalMerge(files, output), 4);
+    EXPECT_EQUAL(readIntFile(output), small);
+    Vector<string> none;
+    EXPECT_EQUAL(externalMerge(none, output), 0);
+    EXPECT_EQUAL(readIntFile(output), Vector<int>());
+    deleteFiles(files);
+    deleteFile(output);
+}
+
+STUDENT_TEST("externalMerge rejects missing, unsorted and partial files and tiny budgets") {
+    string output = getTempDirectory() + "/merged.bin";
+    string input = getTempDirectory() + "/input.bin";
+    Vector<string> missing = {getTempDirectory() + "/missing.bin"}, once = {input}, twice = {input, input};
+    EXPECT_ERROR(externalMerge(missing, output));
+
+    Vector<int> unsorted;
+    for (int i = 0; i < 5000; i++) {
+        unsorted.add(i == 3000 ? -1 : i);
+    }
+    writeIntFile(input, unsorted);
+    EXPECT_ERROR(externalMerge(once, output, 4 * 4096));
+
+    FILE* partial = fopen(input.c_str(), "wb");
+    fputs("abcdef", partial);
+    fclose(partial);
+    EXPECT_ERROR(externalMerge(once, output));
+
+    writeIntFile(input, {1, 2, 3});
+    EXPECT_ERROR(externalMerge(twice, output, 4096));
+    deleteFile(input);
+    deleteFile(output);
+}
+
+STUDENT_TEST("Time externalMerge throughput in MB/s against the number of files") {
+    int total = 16 << 20;                   // 64 MB of ints
+    string output = getTempDirectory() + "/merged.bin";
+    for (int k : {2, 8, 32, 128, 512}) {
+        // sorted runs of random gaps, quicker to make than sorting random values
+        Vector<string> files;
+        for (int i = 0; i < k; i++) {
+            Vector<int> run;
+            int value = 0;
+            for (int j = 0; j < total / k; j++) {
+                value += randomInteger(0, 2 * k);
+                run.add(value);
+            }
+            files.add(getTempDirectory() + "/run" + to_string(i) + ".bin");
+            writeIntFile(files[i], run);
+        }
+        auto start = chrono::steady_clock::now();
+        long long count = externalMerge(files, output, 16 << 20);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << k << " files: " << count * sizeof(int) / seconds / (1 << 20) << " MB/s" << endl;
+        deleteFiles(files);
+    }
+    deleteFile(output);
+}
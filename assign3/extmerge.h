@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include "vector.h"
+
+/*
+ * Merge of sorted files too large to hold in memory. Each input is a binary
+ * file of native-endian 32-bit ints in increasing order, and so is the
+ * output.
+ *
+ * Every input is read through two blocks: while the merge consumes one, a
+ * background I/O thread already fills the other, so the merge rarely waits
+ * for the disk. The heads of the inputs compete in a loser tree, and the
+ * output is gathered in two page-aligned blocks written by the same thread
+ * in whole blocks. The blocks, two per input and two for the output, share
+ * <memoryBudget> bytes, each rounded down to a multiple of 4096 bytes.
+ *
+ * @return The number of ints written to <outputFile>
+ */
+long long externalMerge(const Vector<std::string>& inputFiles, std::string outputFile,
+                        long long memoryBudget = 64LL << 20);
+
+void writeIntFile(std::string filename, const Vector<int>& values);
+Vector<int> readIntFile(std::string filename);
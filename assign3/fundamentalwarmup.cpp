@@ -6,26 +6,30 @@
  */
 
 #include <iostream>    // for cout, endl
+#include <chrono>
+#include <climits>
+#include <cfloat>
+#include <cmath>
 #include "error.h"
 #include "random.h"
+#include "recursion.h"
 #include "testing/SimpleTest.h"
 using namespace std;
 
 
-/* This is a recursive implementation of a function to calculate
- * factorials. This function works correctly for positive values
- * of n whose computed factorial value does not overflow the int
- * data type (n <= 12).
- *
- * As currently written, this function does not correctly handle
- * negative inputs.
+/* The factorial of n for 0 <= n <= 12, the largest whose factorial fits
+ * in an int; factorialExact handles any n. Computed with a loop, and
+ * errors on negative n and on n that would overflow.
  */
 int factorial(int n) {
-    if (n == 0) {
-        return 1;
-    } else {
-        return n * factorial(n - 1);
+    if (n < 0 || n > 12) {
+        error("factorial(n) needs 0 <= n <= 12; use factorialExact for larger n");
+    }
+    int result = 1;
+    for (int i = 2; i <= n; i++) {
+        result *= i;
     }
+    return result;
 }
 
 
@@ -36,23 +40,139 @@ int factorial(int n) {
  * to have a fractional component, such as would be needed for
  * a negative exponent.
  *
- * WARNING: The given implementation is BUGGY! It works mostly correctly
- * but it has some bugs that you should find and fix. Refer to the
- * writeup for further instructions on how to do so.
+ * The original recursion took one call per unit of exp, so large exponents
+ * overflowed the call stack; it now squares its way up with fastPower.
  */
 double myPower(int base, int exp) {
-    if (exp == 0) {         // handle zero exp
-        return 1;
-    } else if (exp < 0) {   // handle negative exp
-        return 1.0 / myPower(base, -exp);
-    } else {                // both base and exp are positive
-        return base * myPower(base, exp - 1);
+    return fastPower(base, exp);
+}
+
+
+/* Binary exponentiation: base^exp is the product of base^(2^i) over the set
+ * bits i of exp, so it takes O(log exp) multiplications instead of exp. Each
+ * squaring doubles the relative rounding error already in base^(2^i), so the
+ * error grows like |exp| times the rounding of one multiplication. The
+ * products are therefore kept in long double and rounded to double once at
+ * the end, for a relative error within about |exp| * LDBL_EPSILON plus that
+ * last rounding. Where long double is the 64-bit-mantissa x87 type (gcc and
+ * clang on x86), that is as exact as pow's up to |exp| of about 2^11; where
+ * long double is just double (MSVC, Apple Silicon), large exponents can be
+ * off from pow in the last few bits. A negative exp gives 1 / base^-exp, or
+ * (1 / base)^-exp once base^-exp is too large for that.
+ */
+double fastPower(double base, long long exp) {
+    // -exp would overflow for LLONG_MIN, so work with the magnitude unsigned
+    unsigned long long remaining = exp < 0 ? 0ULL - (unsigned long long) exp : exp;
+    auto raise = [remaining](long double square) {
+        long double result = 1;
+        for (unsigned long long bits = remaining; bits != 0; bits >>= 1) {
+            if (bits & 1) {
+                result *= square;
+            }
+            square *= square;
+        }
+        return result;
+    };
+    long double result = raise(base);
+    if (exp < 0) {
+        result = isinf(result) && base != 0 ? raise(1.0L / base) : 1.0L / result;
+    }
+    return (double) result;
+}
+
+
+/* Modular exponentiation by the same squaring, for any 64-bit modulus: the
+ * products of two residues are taken in 128 bits before reducing, so nothing
+ * overflows even when the modulus is close to 2^64.
+ *
+ * @return base^exp mod modulus, with 0^0 = 1 (mod modulus)
+ */
+uint64_t modPower(uint64_t base, uint64_t exp, uint64_t modulus) {
+    if (modulus == 0) {
+        error("modPower needs a positive modulus");
+    }
+    uint64_t result = 1 % modulus;
+    base %= modulus;
+    for (; exp != 0; exp >>= 1) {
+        if (exp & 1) {
+            result = (unsigned __int128) result * base % modulus;
+        }
+        base = (unsigned __int128) base * base % modulus;
     }
+    return result;
+}
+
+
+/* The product of the odd numbers from <lo> to <hi>, lo odd, by binary
+ * splitting: the two halves of the range are multiplied separately and then
+ * together, so the big multiplications are between numbers of similar size,
+ * where BigCount's Karatsuba multiplication pays off. Short ranges are
+ * gathered into 64-bit words before becoming BigCounts.
+ */
+static BigCount oddProduct(long long lo, long long hi) {
+    long long count = hi < lo ? 0 : (hi - lo) / 2 + 1;
+    if (count <= 16) {
+        BigCount product(1);
+        uint64_t word = 1;
+        for (long long odd = lo; odd <= hi; odd += 2) {
+            uint64_t next;
+            if (__builtin_mul_overflow(word, (uint64_t) odd, &next)) {
+                product *= BigCount(word);
+                next = odd;
+            }
+            word = next;
+        }
+        return product *= BigCount(word);
+    }
+    long long middle = lo + 2 * (count / 2);
+    return oddProduct(lo, middle - 2) * oddProduct(middle, hi);
+}
+
+
+/* Exact n! by Luschny's split recursive method. Pulling the powers of two out
+ * of n! = (n/2)! * 2^(n/2) * (odd numbers up to n) leaves
+ * odd(n!) = odd((n/2)!) * (odd numbers up to n), which unrolls into
+ * odd(n!) = product over k of (odd numbers up to n / 2^k). The running
+ * product of odd numbers up to n / 2^k grows one range at a time, from the
+ * largest k down, and n! is odd(n!) shifted left by its n - popcount(n)
+ * factors of two. Every factor is a product of a range, so the work is
+ * dominated by a few multiplications of large, balanced numbers.
+ */
+BigCount factorialExact(int n) {
+    if (n < 0) {
+        error("factorialExact(n) needs n >= 0");
+    }
+    BigCount odd(1);
+    BigCount oddsUpTo(1);
+    for (int k = 30; k >= 0; k--) {
+        long long hi = n >> k;
+        long long lo = (n >> (k + 1)) + 1;
+        if (hi < 1) {
+            continue;
+        }
+        oddsUpTo *= oddProduct(lo | 1, hi);
+        odd *= oddsUpTo;
+    }
+    return odd <<= n - __builtin_popcount(n);
 }
 
 
 /* * * * * * Test Cases * * * * * */
 
+/* Whether fastPower's <actual> for base^exp is within the bound its comment
+ * promises of pow's result: |exp| roundings of long double, plus one of double
+ * for the final rounding and one for pow's own, and a tiny absolute slack for
+ * results that underflow to subnormals.
+ */
+static bool closeToPow(double actual, double base, long long exp) {
+    double expected = pow(base, (double) exp);
+    if (actual == expected) {
+        return true;
+    }
+    long double bound = fabsl((long double) exp) * LDBL_EPSILON + 2 * DBL_EPSILON;
+    return fabs(actual - expected) <= bound * fabs(expected) + 1e-300;
+}
+
 PROVIDED_TEST("Confirm result of factorial(7)") {
     EXPECT_EQUAL(factorial(7), 7*6*5*4*3*2);
 }
@@ -77,3 +197,122 @@ PROVIDED_TEST("myPower(), generated inputs") {
 //     EXPECT_EQUAL(myPower(1, 40000), pow(1, 40000)); // SIGSEGV
 // }
 
+STUDENT_TEST("factorial rejects inputs whose factorial is not an int") {
+    EXPECT_EQUAL(factorial(0), 1);
+    EXPECT_EQUAL(factorial(12), 479001600);
+    EXPECT_ERROR(factorial(-1));
+    EXPECT_ERROR(factorial(13));
+}
+
+STUDENT_TEST("myPower no longer recurses once per unit of exp") {
+    EXPECT_EQUAL(myPower(1, 40000), pow(1, 40000));
+    EXPECT_EQUAL(myPower(-1, INT_MAX), -1);
+    EXPECT_EQUAL(myPower(-1, INT_MIN), 1);
+    EXPECT_EQUAL(myPower(2, INT_MIN), 0);
+    EXPECT_EQUAL(myPower(0, -3), pow(0, -3));
+    EXPECT_EQUAL(myPower(-2, 63), pow(-2, 63));
+    EXPECT(closeToPow(myPower(10, 308), 10, 308));
+    if (LDBL_MANT_DIG > DBL_MANT_DIG) {
+        EXPECT_EQUAL(myPower(10, 308), pow(10, 308));
+    }
+    EXPECT_EQUAL(myPower(10, 309), pow(10, 309));
+    EXPECT_EQUAL(myPower(10, -2), pow(10, -2));
+}
+
+STUDENT_TEST("fastPower, compare to library pow(), random and large exponents") {
+    for (int trial = 0; trial < 2000; trial++) {
+        double base = randomReal(-3, 3);
+        long long exp = randomInteger(-200, 200);
+        EXPECT(closeToPow(fastPower(base, exp), base, exp));
+    }
+    // bases near 1 stay finite for exponents in the billions, where the error
+    // grows like |exp| * LDBL_EPSILON
+    for (long long exp : {1000000LL, 123456789LL, 1000000000LL, -987654321LL, 1LL << 40}) {
+        double base = 1 + 1.0 / exp;
+        EXPECT(closeToPow(fastPower(base, exp), base, exp));
+    }
+    EXPECT_EQUAL(fastPower(2, 1023), pow(2, 1023));
+    EXPECT_EQUAL(fastPower(2, 1024), pow(2, 1024));
+    EXPECT_EQUAL(fastPower(2, -1074), pow(2, -1074));
+    EXPECT_EQUAL(fastPower(0.5, LLONG_MIN), pow(0.5, (double) LLONG_MIN));
+}
+
+STUDENT_TEST("modPower agrees with repeated multiplication and with Fermat") {
+    for (uint64_t modulus : {1ULL, 2ULL, 7ULL, 1000ULL, 65537ULL}) {
+        for (uint64_t base = 0; base < 20; base++) {
+            uint64_t expected = 1 % modulus;
+            for (uint64_t exp = 0; exp < 40; exp++) {
+                EXPECT_EQUAL(modPower(base, exp, modulus), expected);
+                expected = expected * base % modulus;
+            }
+        }
+    }
+    // a^(p-1) = 1 mod p for prime p, even for p close to 2^64
+    const uint64_t p = 18446744073709551557ULL;     // 2^64 - 59
+    for (uint64_t a : {(uint64_t) 2, (uint64_t) 3, (uint64_t) 1234567891011, p - 1}) {
+        EXPECT_EQUAL(modPower(a, p - 1, p), 1);
+    }
+    EXPECT_EQUAL(modPower(2, UINT64_MAX, p), 576460752303423488ULL);
+    EXPECT_EQUAL(modPower(3, 1000000000000000000ULL, 1000000007), 246336683);
+    EXPECT_EQUAL(modPower(123456789, 987654321, (1ULL << 61) - 1), 50357601586279104ULL);
+    EXPECT_ERROR(modPower(2, 3, 0));
+}
+
+STUDENT_TEST("factorialExact matches known factorials") {
+    uint64_t expected = 1;
+    for (int n = 0; n <= 20; n++) {
+        EXPECT_EQUAL(factorialExact(n), BigCount(expected));
+        expected *= n + 1;
+    }
+    EXPECT_EQUAL(factorialExact(25).toString(), "15511210043330985984000000");
+    EXPECT_EQUAL(factorialExact(100).toString(),
+                 "93326215443944152681699238856266700490715968264381621468592963895217599993229915608941"
+                 "463976156518286253697920827223758251185210916864000000000000000000000000");
+    string thousand = factorialExact(1000).toString();
+    EXPECT_EQUAL(thousand.size(), 2568);
+    EXPECT_EQUAL(thousand.substr(0, 30), "402387260077093773543702433923");
+    EXPECT_EQUAL(thousand.find_last_not_of('0'), thousand.size() - 249 - 1);
+    string tenThousand = factorialExact(10000).toString();
+    EXPECT_EQUAL(tenThousand.size(), 35660);
+    EXPECT_EQUAL(tenThousand.substr(0, 20), "28462596809170545189");
+    EXPECT_ERROR(factorialExact(-1));
+}
+
+STUDENT_TEST("factorialExact(100000) has the right size and remainders") {
+    int n = 100000;
+    BigCount big = factorialExact(n);
+    EXPECT_EQUAL(big.numBits(), 1516705);
+    for (uint64_t modulus : {1000000007ULL, 998244353ULL}) {
+        uint64_t expected = 1;
+        for (int i = 2; i <= n; i++) {
+            expected = expected * i % modulus;
+        }
+        EXPECT_EQUAL(big.remainder(modulus), expected);
+    }
+    EXPECT_EQUAL(big.remainder(1000000007), 457992974);
+    EXPECT_EQUAL(factorialExact(n - 1) * BigCount(n), big);
+}
+
+STUDENT_TEST("Time fastPower and modPower on large exponents") {
+    for (long long exp : {1000LL, 1000000LL, 1000000000LL, 1000000000000000000LL}) {
+        TIME_OPERATION(exp, fastPower(1 + 1e-18, exp));
+        TIME_OPERATION(exp, modPower(3, exp, 1000000007));
+    }
+}
+
+STUDENT_TEST("Time factorialExact up to n = 10^5") {
+    for (int n = 1000; n <= 100000; n *= 10) {
+        TIME_OPERATION(n, factorialExact(n));
+    }
+    // the same product multiplied in order, one factor at a time
+    for (int n = 1000; n <= 100000; n *= 10) {
+        auto start = chrono::steady_clock::now();
+        BigCount product(1);
+        for (int i = 2; i <= n; i++) {
+            product *= BigCount(i);
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << "n = " << n << ": one factor at a time " << seconds << " s, "
+             << product.numBits() << " bits" << endl;
+    }
+}
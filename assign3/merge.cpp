@@ -5,8 +5,17 @@
  * comments on each function and on complex code sections.
  */
 #include <iostream>    // for cout, endl
+#include <algorithm>
+#include <chrono>
 #include <climits>
+#include <thread>
+#include <vector>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MERGE_AVX2 1    // the AVX2 kernel is compiled in, and used if the CPU has AVX2
+#include <immintrin.h>
+#endif
 #include "queue.h"
+#include "recursion.h"
 #include "testing/SimpleTest.h"
 using namespace std;
 
@@ -98,10 +107,379 @@ Queue<int> recMultiMerge(Vector<Queue<int>>& all) {
 }
 
 
+/*
+ * Merge k sorted runs into <out> in one pass with a tournament (loser) tree.
+ * The leaves are the heads of the runs; every internal node remembers the
+ * run that lost the match played there, and the overall winner is the
+ * smallest head. After the winner is written out, only the matches on the
+ * path from its leaf to the root are replayed, so each element costs
+ * ceil(log2 k) comparisons and the merge is O(n log k). Equal values are
+ * taken from the lower-numbered run first, so the merge is stable.
+ *
+ * @param runs The runs to merge, each in increasing order
+ * @param out Space for the total number of elements in all runs
+ */
+void loserTreeMerge(const Vector<SortedRun>& runs, int* out) {
+    int k = runs.size();
+    long long total = 0;
+    for (const SortedRun& run : runs) {
+        total += run.size;
+    }
+    if (k == 0 || total == 0) {
+        return;
+    }
+
+    // the current head of each run, LLONG_MAX once it is used up, and where it is
+    vector<long long> key(k);
+    vector<const int*> next(k), last(k);
+    for (int run = 0; run < k; run++) {
+        next[run] = runs[run].data;
+        last[run] = runs[run].data + runs[run].size;
+        key[run] = runs[run].size > 0 ? *next[run] : LLONG_MAX;
+    }
+    auto beats = [&](int a, int b) {
+        return key[a] < key[b] || (key[a] == key[b] && a < b);
+    };
+
+    // leaves sit at positions k..2k-1 of an implicit tree, internal nodes at 1..k-1;
+    // play the initial tournament bottom-up, keeping the loser at every node
+    vector<int> loser(k, -1);
+    vector<int> winner(2 * k);
+    for (int run = 0; run < k; run++) {
+        winner[k + run] = run;
+    }
+    for (int node = k - 1; node >= 1; node--) {
+        int left = winner[2 * node], right = winner[2 * node + 1];
+        bool leftWins = beats(left, right);
+        winner[node] = leftWins ? left : right;
+        loser[node] = leftWins ? right : left;
+    }
+    int champion = k == 1 ? 0 : winner[1];
+
+    for (long long i = 0; i < total; i++) {
+        out[i] = *next[champion]++;
+        key[champion] = next[champion] < last[champion] ? *next[champion] : LLONG_MAX;
+        for (int node = (k + champion) / 2; node >= 1; node /= 2) {
+            if (beats(loser[node], champion)) {
+                swap(loser[node], champion);
+            }
+        }
+    }
+}
+
+/*
+ * A k-way merge of sorted Vectors into one Vector allocated once at its
+ * final size, using loserTreeMerge: no queue copies and no intermediate merges
+ */
+Vector<int> kWayMerge(const Vector<Vector<int>>& all) {
+    Vector<SortedRun> runs;
+    int total = 0;
+    for (const Vector<int>& v : all) {
+        for (int i = 1; i < v.size(); i++) {
+            if (v[i - 1] > v[i]) {
+                error("Every sequence to merge must be increasing");
+            }
+        }
+        runs.add({v.isEmpty() ? nullptr : &v[0], v.size()});
+        total += v.size();
+    }
+    Vector<int> result(total);
+    if (total > 0) {
+        loserTreeMerge(runs, &result[0]);
+    }
+    return result;
+}
+
+/*
+ * @return Whether <data> is in increasing (non-decreasing) order. Written
+ *         without an early exit so the compiler can vectorize the scan.
+ */
+bool isIncreasing(const int* data, int size) {
+    int descents = 0;
+    for (int i = 1; i < size; i++) {
+        descents += data[i - 1] > data[i];
+    }
+    return descents == 0;
+}
+
+/*
+ * Merge two sorted arrays into <out> without a data-dependent branch per
+ * element: both heads are compared, the smaller is selected with a
+ * conditional move and each index advances by the result of the comparison.
+ * The branch that binaryMerge takes on every element is unpredictable on
+ * random data; this loop only branches on the loop bounds.
+ *
+ * @param out Space for sizeA + sizeB elements
+ */
+void branchlessMerge(const int* a, int sizeA, const int* b, int sizeB, int* out) {
+    int i = 0, j = 0;
+    while (i < sizeA && j < sizeB) {
+        int x = a[i], y = b[j];
+        bool takeA = x <= y;
+        *out++ = takeA ? x : y;
+        i += takeA;
+        j += !takeA;
+    }
+    out = copy(a + i, a + sizeA, out);
+    copy(b + j, b + sizeB, out);
+}
+
+#if defined(MERGE_AVX2)
+/*
+ * Sort a bitonic sequence of 8 ints held in one register: compare-exchange
+ * lanes 4 apart, then 2 apart, then 1 apart
+ */
+__attribute__((target("avx2")))
+static inline __m256i bitonicSort8(__m256i v) {
+    __m256i other = _mm256_permute2x128_si256(v, v, 1);
+    v = _mm256_blend_epi32(_mm256_min_epi32(v, other), _mm256_max_epi32(v, other), 0xF0);
+    other = _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+    v = _mm256_blend_epi32(_mm256_min_epi32(v, other), _mm256_max_epi32(v, other), 0xCC);
+    other = _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm256_blend_epi32(_mm256_min_epi32(v, other), _mm256_max_epi32(v, other), 0xAA);
+}
+
+/*
+ * Bitonic merge of two sorted 8-int registers: <low> receives the 8 smallest
+ * of the 16 and <high> the 8 largest, both sorted
+ */
+__attribute__((target("avx2")))
+static inline void bitonicMerge8(__m256i a, __m256i b, __m256i& low, __m256i& high) {
+    b = _mm256_permutevar8x32_epi32(b, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+    low = bitonicSort8(_mm256_min_epi32(a, b));
+    high = bitonicSort8(_mm256_max_epi32(a, b));
+}
+
+/*
+ * The vector merge: 8 elements at a time go through the bitonic network with
+ * the 8 largest seen so far, and the 8 smallest come out. The next block is
+ * read from whichever input has the smaller head, which guarantees every
+ * element still to come is at least the largest one written. Once an input
+ * has fewer than 8 elements left, the held-back block, that input's tail and
+ * the other input finish in branchlessMerge.
+ *
+ * Only these functions are compiled for AVX2, so the program runs on any x86
+ * CPU and mergeKernel calls this only after checking the CPU supports it.
+ */
+__attribute__((target("avx2")))
+static void avx2Merge(const int* a, int sizeA, const int* b, int sizeB, int* out) {
+    if (sizeA < 8 || sizeB < 8) {
+        branchlessMerge(a, sizeA, b, sizeB, out);
+        return;
+    }
+    __m256i low, high;
+    bitonicMerge8(_mm256_loadu_si256((const __m256i*) a), _mm256_loadu_si256((const __m256i*) b), low, high);
+    _mm256_storeu_si256((__m256i*) out, low);
+    out += 8;
+    int i = 8, j = 8;
+    while (i + 8 <= sizeA && j + 8 <= sizeB) {
+        bool takeA = a[i] <= b[j];
+        const int* next = takeA ? a + i : b + j;
+        i += takeA ? 8 : 0;
+        j += takeA ? 0 : 8;
+        bitonicMerge8(_mm256_loadu_si256((const __m256i*) next), high, low, high);
+        _mm256_storeu_si256((__m256i*) out, low);
+        out += 8;
+    }
+
+    // merge the held-back block with the short tail, then that with the rest
+    int held[8], shortMerged[16];
+    _mm256_storeu_si256((__m256i*) held, high);
+    if (sizeA - i < 8) {
+        branchlessMerge(held, 8, a + i, sizeA - i, shortMerged);
+        branchlessMerge(shortMerged, 8 + sizeA - i, b + j, sizeB - j, out);
+    } else {
+        branchlessMerge(held, 8, b + j, sizeB - j, shortMerged);
+        branchlessMerge(a + i, sizeA - i, shortMerged, 8 + sizeB - j, out);
+    }
+}
+#endif
+
+/*
+ * @return Whether mergeKernel uses the AVX2 merge on this CPU
+ */
+bool mergeKernelUsesAvx2() {
+#if defined(MERGE_AVX2)
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+/*
+ * Merge two sorted int arrays into <out>, using the AVX2 bitonic merge when
+ * the CPU supports AVX2 and branchlessMerge otherwise. The sortedness check
+ * of binaryMerge is a separate pass here, which <checkSorted> turns off for
+ * input already known to be sorted.
+ *
+ * @param out Space for sizeA + sizeB elements
+ */
+void mergeKernel(const int* a, int sizeA, const int* b, int sizeB, int* out, bool checkSorted) {
+    if (checkSorted && !isIncreasing(a, sizeA)) {
+        error("The parameter <a> must be an increasing sequence");
+    }
+    if (checkSorted && !isIncreasing(b, sizeB)) {
+        error("The parameter <b> must be an increasing sequence");
+    }
+#if defined(MERGE_AVX2)
+    if (mergeKernelUsesAvx2()) {
+        avx2Merge(a, sizeA, b, sizeB, out);
+        return;
+    }
+#endif
+    branchlessMerge(a, sizeA, b, sizeB, out);
+}
+
+/*
+ * binaryMerge over Vectors, with the output allocated once and the merge
+ * done by mergeKernel
+ */
+Vector<int> fastBinaryMerge(const Vector<int>& a, const Vector<int>& b, bool checkSorted) {
+    Vector<int> result(a.size() + b.size());
+    if (!result.isEmpty()) {
+        mergeKernel(a.isEmpty() ? nullptr : &a[0], a.size(), b.isEmpty() ? nullptr : &b[0], b.size(),
+                    &result[0], checkSorted);
+    }
+    return result;
+}
+
+/*
+ * The merge path of two sorted arrays is the route the sequential merge
+ * takes through them; the first d elements of the output are a[0..i) and
+ * b[0..d-i) for exactly one i, the co-rank of d. It is found by binary search
+ * on the diagonal d: i is too large while a[i-1] > b[d-i], too small while
+ * b[d-i-1] >= a[i] (ties go to <a>, as in the sequential merge).
+ *
+ * @return The number of elements of <a> among the first <d> of the merge
+ */
+int coRank(int d, const int* a, int sizeA, const int* b, int sizeB) {
+    int lo = max(0, d - sizeB), hi = min(d, sizeA);
+    while (lo < hi) {
+        int i = lo + (hi - lo) / 2;
+        if (a[i] <= b[d - i - 1]) {
+            lo = i + 1;                 // a[i] is taken before b[d-i-1], so more of <a>
+        } else {
+            hi = i;
+        }
+    }
+    return lo;
+}
+
+/*
+ * Merge the part [from, to) of the output of merging <a> and <b>
+ */
+static void mergeRange(const int* a, int sizeA, const int* b, int sizeB, int* out, int from, int to) {
+    int i0 = coRank(from, a, sizeA, b, sizeB), i1 = coRank(to, a, sizeA, b, sizeB);
+    mergeKernel(a + i0, i1 - i0, b + from - i0, to - from - (i1 - i0), out + from, false);
+}
+
+/*
+ * Run work(thread) for every thread number below <numThreads>, the last one on
+ * the calling thread
+ */
+template <typename Work>
+static void runThreads(int numThreads, Work work) {
+    vector<thread> threads;
+    for (int t = 0; t < numThreads - 1; t++) {
+        threads.emplace_back(work, t);
+    }
+    work(numThreads - 1);
+    for (thread& t : threads) {
+        t.join();
+    }
+}
+
+/*
+ * Merge two sorted arrays on <numThreads> threads. The output is cut into
+ * equal slices and each thread finds where its slice starts and ends in both
+ * inputs with coRank, then merges just that part; the slices are independent,
+ * so the threads never synchronize and the result is the sequential one. The
+ * inputs are trusted to be sorted.
+ *
+ * @param out Space for sizeA + sizeB elements
+ */
+void parallelMerge(const int* a, int sizeA, const int* b, int sizeB, int* out, int numThreads) {
+    long long total = (long long) sizeA + sizeB;
+    numThreads = max(1LL, min((long long) numThreads, total / 4096 + 1));
+    runThreads(numThreads, [&](int t) {
+        mergeRange(a, sizeA, b, sizeB, out, total * t / numThreads, total * (t + 1) / numThreads);
+    });
+}
+
+/*
+ * A k-way merge as rounds of pairwise merges, each round on all threads. The
+ * runs sit back to back in one buffer, so a round's merged pairs fill another
+ * buffer in the same positions; each thread takes an equal slice of that
+ * buffer and merges its share of every pair the slice overlaps, as in
+ * parallelMerge. After ceil(log2 k) rounds the buffer holds the result.
+ */
+Vector<int> parallelKWayMerge(const Vector<Vector<int>>& all, int numThreads) {
+    vector<int> start = {0};
+    for (const Vector<int>& v : all) {
+        if (!isIncreasing(v.isEmpty() ? nullptr : &v[0], v.size())) {
+            error("Every sequence to merge must be increasing");
+        }
+        start.push_back(start.back() + v.size());
+    }
+    int total = start.back();
+    Vector<int> result(total);
+    if (total == 0) {
+        return result;
+    }
+    vector<int> buffer(total);
+    for (int i = 0; i < all.size(); i++) {
+        if (!all[i].isEmpty()) {
+            copy(&all[i][0], &all[i][0] + all[i].size(), buffer.begin() + start[i]);
+        }
+    }
+
+    // ping-pong between <buffer> and <result>, ending in <result>
+    int rounds = 0;
+    while ((1 << rounds) < all.size()) {
+        rounds++;
+    }
+    int* from = buffer.data();
+    int* to = &result[0];
+    if (rounds % 2 == 0) {
+        copy(buffer.begin(), buffer.end(), to);
+        swap(from, to);
+    }
+    for (int round = 0; round < rounds; round++) {
+        int threads = max(1, min(numThreads, total / 4096 + 1));
+        runThreads(threads, [&](int t) {
+            int lo = (long long) total * t / threads, hi = (long long) total * (t + 1) / threads;
+            for (int left = 0; left + 1 < (int) start.size(); left += 2) {
+                int mid = min(left + 1, (int) start.size() - 1);
+                int right = min(left + 2, (int) start.size() - 1);
+                int begin = start[left], middle = start[mid], end = start[right];
+                if (end <= lo || begin >= hi) {
+                    continue;
+                }
+                mergeRange(from + begin, middle - begin, from + middle, end - middle, to + begin,
+                           max(lo, begin) - begin, min(hi, end) - begin);
+            }
+        });
+        vector<int> merged;
+        for (int i = 0; i < (int) start.size(); i += 2) {
+            merged.push_back(start[i]);
+        }
+        if (merged.back() != total) {
+            merged.push_back(total);
+        }
+        start = merged;
+        swap(from, to);
+    }
+    return result;
+}
+
 /* * * * * * Test Cases * * * * * */
 
 Queue<int> createSequence(int size);
 void distribute(Queue<int> input, Vector<Queue<int>>& all);
+Vector<Vector<int>> toVectors(const Vector<Queue<int>>& all);
+Vector<int> toVector(Queue<int> q);
+Queue<int> createRandomSequence(int size);
 
 PROVIDED_TEST("binaryMerge, two short sequences") {
     Queue<int> a = {2, 4, 5};
@@ -185,6 +563,204 @@ PROVIDED_TEST("Time recMultiMerge operation") {
 }
 
 
+STUDENT_TEST("kWayMerge, small collection of short sequences") {
+    Vector<Vector<int>> all = {{3, 6, 9, 9, 100},
+                               {1, 5, 9, 9, 12},
+                               {5},
+                               {},
+                               {-5, -5},
+                               {3402},
+                               {INT_MIN, INT_MAX}
+                              };
+    Vector<int> expected = {INT_MIN, -5, -5, 1, 3, 5, 5, 6, 9, 9, 9, 9, 12, 100, 3402, INT_MAX};
+    EXPECT_EQUAL(kWayMerge(all), expected);
+    Vector<Vector<int>> none, empties = {{}, {}}, one = {{4, 7}}, unsorted = {{1, 2}, {3, 1}};
+    EXPECT_EQUAL(kWayMerge(none), Vector<int>());
+    EXPECT_EQUAL(kWayMerge(empties), Vector<int>());
+    EXPECT_EQUAL(kWayMerge(one), one[0]);
+    EXPECT_ERROR(kWayMerge(unsorted));
+}
+
+STUDENT_TEST("kWayMerge, compare to recMultiMerge for many k") {
+    for (int k : {1, 2, 3, 5, 8, 13, 64, 100, 1000}) {
+        Queue<int> input = createSequence(5000);
+        Vector<Queue<int>> all(k);
+        distribute(input, all);
+        EXPECT_EQUAL(kWayMerge(toVectors(all)), toVector(recMultiMerge(all)));
+    }
+}
+
+STUDENT_TEST("Time kWayMerge operation, same cases as recMultiMerge") {
+    // Measure n
+    int n = 11000;
+    int k = n/10;
+    for (int power = 1; power <= 256; power *= 4) {
+        Queue<int> input = createSequence(n * power);
+        Vector<Queue<int>> all(k);
+        distribute(input, all);
+        Vector<Vector<int>> vectors = toVectors(all);
+        TIME_OPERATION(input.size(), kWayMerge(vectors));
+    }
+
+    // Measure k
+    n = 110000;
+    k = n/10;
+    for (int power = 1; power <= 256; power *= 4) {
+        Queue<int> input = createSequence(n);
+        Vector<Queue<int>> all(k / power);
+        distribute(input, all);
+        Vector<Vector<int>> vectors = toVectors(all);
+        TIME_OPERATION(input.size(), kWayMerge(vectors));
+    }
+}
+
+
+STUDENT_TEST("branchlessMerge and mergeKernel match std::merge on random arrays") {
+    cout << "mergeKernel uses " << (mergeKernelUsesAvx2() ? "the AVX2 merge" : "branchlessMerge") << endl;
+    for (int trial = 0; trial < 500; trial++) {
+        int sizeA = randomInteger(0, trial < 250 ? 40 : 2000);
+        int sizeB = randomInteger(0, trial < 250 ? 40 : 2000);
+        int range = randomChance(0.5) ? 10 : 1000000;
+        vector<int> a(sizeA), b(sizeB);
+        for (int& x : a) {
+            x = randomInteger(-range, range);
+        }
+        for (int& x : b) {
+            x = randomInteger(-range, range);
+        }
+        if (sizeA > 0 && randomChance(0.2)) {
+            a[0] = INT_MIN;
+        }
+        if (sizeB > 0 && randomChance(0.2)) {
+            b[0] = INT_MAX;
+        }
+        sort(a.begin(), a.end());
+        sort(b.begin(), b.end());
+        vector<int> expected(sizeA + sizeB), scalar(sizeA + sizeB), kernel(sizeA + sizeB);
+        merge(a.begin(), a.end(), b.begin(), b.end(), expected.begin());
+        branchlessMerge(a.data(), sizeA, b.data(), sizeB, scalar.data());
+        mergeKernel(a.data(), sizeA, b.data(), sizeB, kernel.data());
+        EXPECT(scalar == expected);
+        EXPECT(kernel == expected);
+    }
+}
+
+STUDENT_TEST("fastBinaryMerge, short sequences and the sortedness check") {
+    Vector<int> a = {2, 4, 5};
+    Vector<int> b = {1, 3, 3};
+    Vector<int> expected = {1, 2, 3, 3, 4, 5};
+    EXPECT_EQUAL(fastBinaryMerge(a, b), expected);
+    EXPECT_EQUAL(fastBinaryMerge(b, a), expected);
+    EXPECT_EQUAL(fastBinaryMerge(a, {}), a);
+    Vector<int> unsorted = {3, 1, 2};
+    EXPECT_ERROR(fastBinaryMerge(a, unsorted));
+    EXPECT_ERROR(fastBinaryMerge(unsorted, a));
+    EXPECT(isIncreasing(&a[0], a.size()));
+    EXPECT(!isIncreasing(&unsorted[0], unsorted.size()));
+}
+
+STUDENT_TEST("Time fastBinaryMerge against binaryMerge, with and without the sortedness check") {
+    int n = 100000;
+    for (int power = 1; power <= 256; power *= 4) {
+        Queue<int> a = createSequence(n * power);
+        Queue<int> b = createSequence(n * power);
+        TIME_OPERATION(a.size() + b.size(), binaryMerge(a, b));
+        Vector<int> vectorA = toVector(a), vectorB = toVector(b);
+        TIME_OPERATION(vectorA.size() + vectorB.size(), fastBinaryMerge(vectorA, vectorB));
+        TIME_OPERATION(vectorA.size() + vectorB.size(), fastBinaryMerge(vectorA, vectorB, false));
+    }
+
+    // equal sequences interleave in a fixed pattern; random gaps make binaryMerge's branch unpredictable
+    for (int power = 1; power <= 256; power *= 4) {
+        Queue<int> a = createRandomSequence(n * power);
+        Queue<int> b = createRandomSequence(n * power);
+        TIME_OPERATION(a.size() + b.size(), binaryMerge(a, b));
+        Vector<int> vectorA = toVector(a), vectorB = toVector(b);
+        TIME_OPERATION(vectorA.size() + vectorB.size(), fastBinaryMerge(vectorA, vectorB, false));
+    }
+}
+
+
+STUDENT_TEST("parallelMerge matches std::merge for any number of threads") {
+    for (int trial = 0; trial < 200; trial++) {
+        int sizeA = randomInteger(0, trial < 100 ? 50 : 100000);
+        int sizeB = randomChance(0.2) ? 0 : randomInteger(0, trial < 100 ? 50 : 100000);
+        int range = randomChance(0.5) ? 5 : 1000000;
+        vector<int> a(sizeA), b(sizeB);
+        for (int& x : a) {
+            x = randomInteger(-range, range);
+        }
+        for (int& x : b) {
+            x = randomInteger(-range, range);
+        }
+        sort(a.begin(), a.end());
+        sort(b.begin(), b.end());
+        vector<int> expected(sizeA + sizeB);
+        merge(a.begin(), a.end(), b.begin(), b.end(), expected.begin());
+        for (int d : {0, sizeA + sizeB, (sizeA + sizeB) / 3}) {
+            int i = coRank(d, a.data(), sizeA, b.data(), sizeB);
+            vector<int> prefix(a.begin(), a.begin() + i);
+            prefix.insert(prefix.end(), b.begin(), b.begin() + d - i);
+            sort(prefix.begin(), prefix.end());
+            EXPECT(equal(prefix.begin(), prefix.end(), expected.begin()));
+        }
+        int threads = randomInteger(1, 8);
+        vector<int> actual(sizeA + sizeB);
+        parallelMerge(a.data(), sizeA, b.data(), sizeB, actual.data(), threads);
+        EXPECT(actual == expected);
+    }
+}
+
+STUDENT_TEST("parallelKWayMerge matches kWayMerge for any number of threads") {
+    for (int k : {1, 2, 3, 5, 8, 13, 64, 1000}) {
+        for (int threads : {1, 2, 3, 8}) {
+            Queue<int> input = createRandomSequence(randomInteger(0, 50000));
+            Vector<Queue<int>> all(k);
+            distribute(input, all);
+            Vector<Vector<int>> vectors = toVectors(all);
+            EXPECT_EQUAL(parallelKWayMerge(vectors, threads), kWayMerge(vectors));
+        }
+    }
+    Vector<Vector<int>> none, unsorted = {{1, 2}, {3, 1}};
+    EXPECT_EQUAL(parallelKWayMerge(none, 4), Vector<int>());
+    EXPECT_ERROR(parallelKWayMerge(unsorted, 4));
+}
+
+STUDENT_TEST("Time parallelMerge and parallelKWayMerge from 1 to N threads on 100M elements") {
+    int n = 100000000;
+    int maxThreads = max(4, (int) thread::hardware_concurrency());
+    {
+        // scoped, so the 800 MB of the two-way merge is freed before the k-way one
+        vector<int> a(n / 2), b(n / 2), out(n);
+        int value = 0;
+        for (int i = 0; i < n / 2; i++) {
+            a[i] = value += randomInteger(0, 3);
+        }
+        value = 0;
+        for (int i = 0; i < n / 2; i++) {
+            b[i] = value += randomInteger(0, 3);
+        }
+        for (int threads = 1; threads <= maxThreads; threads *= 2) {
+            auto start = chrono::steady_clock::now();
+            parallelMerge(a.data(), a.size(), b.data(), b.size(), out.data(), threads);
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            cout << "parallelMerge, " << threads << " threads: " << seconds << "s" << endl;
+        }
+    }
+
+    Vector<Vector<int>> runs(64);
+    for (int i = 0; i < n; i++) {
+        runs[i % 64].add(i);
+    }
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        auto start = chrono::steady_clock::now();
+        Vector<int> merged = parallelKWayMerge(runs, threads);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << "parallelKWayMerge of 64 runs, " << threads << " threads: " << seconds << "s" << endl;
+    }
+}
+
+
 /* Test helper to fill queue with sorted sequence */
 Queue<int> createSequence(int size) {
     Queue<int> q;
@@ -194,6 +770,17 @@ Queue<int> createSequence(int size) {
     return q;
 }
 
+/* Test helper to fill queue with a sorted sequence of random gaps */
+Queue<int> createRandomSequence(int size) {
+    Queue<int> q;
+    int value = 0;
+    for (int i = 0; i < size; i++) {
+        value += randomInteger(0, 3);
+        q.enqueue(value);
+    }
+    return q;
+}
+
 /* Test helper to distribute elements of sorted sequence across k sequences,
    k is size of Vector */
 void distribute(Queue<int> input, Vector<Queue<int>>& all) {
@@ -201,3 +788,21 @@ void distribute(Queue<int> input, Vector<Queue<int>>& all) {
         all[randomInteger(0, all.size()-1)].enqueue(input.dequeue());
     }
 }
+
+/* Test helper to copy each queue into a Vector, for the contiguous merges */
+Vector<Vector<int>> toVectors(const Vector<Queue<int>>& all) {
+    Vector<Vector<int>> result;
+    for (Queue<int> q : all) {
+        result.add(toVector(q));
+    }
+    return result;
+}
+
+/* Test helper to copy a queue into a Vector, front first */
+Vector<int> toVector(Queue<int> q) {
+    Vector<int> result;
+    while (!q.isEmpty()) {
+        result.add(q.dequeue());
+    }
+    return result;
+}
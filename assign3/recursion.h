@@ -1,9 +1,15 @@
 #pragma once
 
 /* Needed for warmup.cpp */
+#include <cstdint>
+#include "bigcount.h"
 int factorial(int n);
 double iterativePower(int base, int exp);
 double power(int base, int exp);
+double myPower(int base, int exp);
+double fastPower(double base, long long exp);
+uint64_t modPower(uint64_t base, uint64_t exp, uint64_t modulus);
+BigCount factorialExact(int n);
 
 /* Needed for balanced.cpp */
 #include <string>
@@ -12,6 +18,38 @@ std::string operatorsFrom(std::string str);
 bool operatorsAreMatched(std::string ops);
 bool parenthesesMatched(char left, char right);
 
+#include <cstdint>
+#include <istream>
+#include <vector>
+
+/*
+ * Bracket checker that reads its input once, in as many chunks as it comes
+ * in. Each byte is classified by a 256-entry table, and open brackets are
+ * kept on a stack whose first kFixedDepth levels live inside the checker, so
+ * checking allocates nothing unless brackets nest deeper than that.
+ */
+class BracketChecker {
+public:
+    BracketChecker();
+
+    bool feed(const char* data, size_t size);
+    bool balanced() const { return !mismatched && depth == 0; }
+    void reset();
+
+private:
+    static const int kFixedDepth = 1024;
+
+    uint8_t fixed[kFixedDepth];         // the bottom of the stack of open brackets
+    std::vector<uint8_t> deeper;        // the rest, only for deep nesting
+    long long depth;
+    bool mismatched;
+};
+
+bool isBalancedLinear(const std::string& str);
+bool isBalancedStream(std::istream& in, size_t chunkBytes = 1 << 16);
+bool isBalancedParallel(const std::string& str, int numThreads);
+bool isBalancedParallel(std::istream& in, int numThreads, size_t chunkBytes = 1 << 26);
+
 
 /* Needed for sierpinski.cpp */
 #include "gtypes.h"
@@ -30,3 +68,22 @@ Queue<int> binaryMerge(Queue<int> a, Queue<int> b);
 Queue<int> naiveMultiMerge(Vector<Queue<int>>& all);
 Queue<int> recMultiMerge(Vector<Queue<int>>& all);
 
+/* A sorted run of ints stored contiguously somewhere else, read but not owned */
+struct SortedRun {
+    const int* data;
+    int size;
+};
+
+void loserTreeMerge(const Vector<SortedRun>& runs, int* out);
+Vector<int> kWayMerge(const Vector<Vector<int>>& all);
+
+bool isIncreasing(const int* data, int size);
+void branchlessMerge(const int* a, int sizeA, const int* b, int sizeB, int* out);
+void mergeKernel(const int* a, int sizeA, const int* b, int sizeB, int* out, bool checkSorted = true);
+bool mergeKernelUsesAvx2();
+Vector<int> fastBinaryMerge(const Vector<int>& a, const Vector<int>& b, bool checkSorted = true);
+
+int coRank(int d, const int* a, int sizeA, const int* b, int sizeB);
+void parallelMerge(const int* a, int sizeA, const int* b, int sizeB, int* out, int numThreads);
+Vector<int> parallelKWayMerge(const Vector<Vector<int>>& all, int numThreads);
+
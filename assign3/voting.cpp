@@ -4,8 +4,15 @@
 // comments on each function and on complex code sections.
 #include <iostream>    // for cout, endl
 #include <string>      // for string class
+#include <climits>
 #include <cmath>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "error.h"
 #include "map.h"
+#include "random.h"
 #include "voting.h"
 #include "testing/SimpleTest.h"
 using namespace std;
@@ -106,6 +113,447 @@ Vector<int> convertToPercentages(const Vector<int>& values) {
     return percentages;
 }
 
+/*
+ * Count the swings of every block with a subset-sum DP instead of visiting
+ * every coalition. A swing of block b is a non-empty coalition of the other
+ * blocks whose votes are at most half the total but exceed it once b joins,
+ * exactly what calculateCriticalVotes counts.
+ *
+ * ways[s] is the number of coalitions of all blocks with s votes, built by
+ * adding one block of weight w at a time: ways[s] += ways[s - w], from the
+ * top down. The coalitions without one block of weight w are recovered by
+ * un-adding it, without[s] = ways[s] - without[s - w] from the bottom up, and
+ * the swings of that block are the coalitions with half - w < s <= half.
+ * Blocks of equal weight have equal swings, so each distinct weight is
+ * un-added once. That is O(n * W) for n blocks and W total votes.
+ *
+ * Counts are kept modulo 2^64, where adding and un-adding are still exact;
+ * they equal the true counts while there are at most 64 blocks.
+ *
+ * @return The number of swings of each block, in the order of <blocks>
+ */
+Vector<uint64_t> countSwings(const Vector<int>& blocks) {
+    int total = 0;
+    for (int block : blocks) {
+        if (block < 0) {
+            error("Blocks must have a non-negative number of votes");
+        }
+        total += block;
+    }
+    int boundary = total / 2;
+
+    vector<uint64_t> ways(total + 1, 0);
+    ways[0] = 1;
+    for (int block : blocks) {
+        for (int s = total; s >= block; s--) {
+            ways[s] += ways[s - block];
+        }
+    }
+
+    Vector<uint64_t> swings;
+    Map<int, uint64_t> memo;
+    vector<uint64_t> without(boundary + 1);
+    for (int block : blocks) {
+        if (block == 0) {
+            // joining never changes the votes of a coalition
+            swings.add(0);
+            continue;
+        }
+        if (!memo.containsKey(block)) {
+            // un-add the block, only up to the boundary as higher sums never swing
+            for (int s = 0; s <= boundary; s++) {
+                without[s] = ways[s] - (s >= block ? without[s - block] : 0);
+            }
+            uint64_t count = 0;
+            for (int s = max(boundary - block + 1, 0); s <= boundary; s++) {
+                count += without[s];
+            }
+            if (block > boundary) {
+                count--;    // the empty coalition is not counted
+            }
+            memo[block] = count;
+        }
+        swings.add(memo[block]);
+    }
+    return swings;
+}
+
+/*
+ * Drop-in replacement for computePowerIndexes using countSwings, giving the
+ * same percentages in O(n * W) instead of O(n * 2^n). Past 64 blocks the
+ * percentages are floor(100 * count / sum), divided exactly on the counts of
+ * countSwingsExact rather than through doubles.
+ */
+Vector<int> computePowerIndexesDP(const Vector<int>& blocks) {
+    if (blocks.size() > 64) {
+        // the counts no longer fit in 64 bits, so count and divide exactly
+        Vector<BigCount> exact = countSwingsExact(blocks);
+        BigCount sum;
+        for (const BigCount& count : exact) {
+            sum += count;
+        }
+        Vector<int> percentages;
+        for (const BigCount& count : exact) {
+            percentages.add(sum == BigCount(0) ? 0 : count.percentOf(sum));
+        }
+        return percentages;
+    }
+    Vector<uint64_t> swings = countSwings(blocks);
+    double sum = 0;
+    for (uint64_t count : swings) {
+        sum += count;
+    }
+    Vector<int> percentages;
+    for (uint64_t count : swings) {
+        percentages.add(sum == 0 ? 0 : static_cast<int>((count / sum) * 100));
+    }
+    return percentages;
+}
+
+/* * * * * * Exact counts * * * * * */
+
+/*
+ * The same swing counts as countSwings, but exact for any number of blocks.
+ *
+ * No coalition count can exceed 2^n for n blocks, so every DP entry is a
+ * fixed array of n / 64 + 1 limbs, laid out back to back in one table. While
+ * the first k blocks are added the counts are below 2^k, so only the limbs
+ * that can be non-zero yet are added. Un-adding subtracts, which is only
+ * exact with integers: in floating point the alternating subtraction cancels
+ * catastrophically, so the counts stay integers and only the final indexes
+ * are doubles.
+ *
+ * The table of all blocks is built once; un-adding one weight from it only
+ * reads that table, so the distinct weights are shared out over <numThreads>
+ * threads, each with its own un-add buffer allocated once. Every weight's
+ * count lands in its own slot, so the result does not depend on the threads.
+ *
+ * @param tableBytes If not null, receives the memory used by the DP tables
+ * @return The exact number of swings of each block, in the order of <blocks>
+ */
+Vector<BigCount> countSwingsExact(const Vector<int>& blocks, long long* tableBytes, int numThreads) {
+    long long total = 0;
+    for (int block : blocks) {
+        if (block < 0) {
+            error("Blocks must have a non-negative number of votes");
+        }
+        total += block;
+    }
+    if (total > INT32_MAX) {
+        error("Total number of votes is too large");
+    }
+    int boundary = total / 2;
+    int numLimbs = blocks.size() / 64 + 1;
+
+    vector<uint64_t> ways((total + 1) * numLimbs, 0);
+    ways[0] = 1;
+    int added = 0;
+    for (int block : blocks) {
+        added++;
+        int active = min(numLimbs, added / 64 + 1);
+        for (long long s = total; s >= block; s--) {
+            addLimbs(&ways[s * numLimbs], active, &ways[(s - block) * numLimbs], active);
+        }
+    }
+
+    // the distinct non-zero weights, each un-added by whichever thread takes it next
+    Map<int, int> weightIndex;
+    Vector<int> weights;
+    for (int block : blocks) {
+        if (block != 0 && !weightIndex.containsKey(block)) {
+            weightIndex[block] = weights.size();
+            weights.add(block);
+        }
+    }
+    numThreads = max(1, min(numThreads, weights.size()));
+    vector<BigCount> perWeight(weights.size());
+    atomic<int> nextWeight(0);
+    auto work = [&]() {
+        vector<uint64_t> without((boundary + 1) * numLimbs);
+        vector<uint64_t> sum(numLimbs);
+        const uint64_t one = 1;
+        for (int i = nextWeight++; i < weights.size(); i = nextWeight++) {
+            int block = weights[i];
+            for (int s = 0; s <= boundary; s++) {
+                uint64_t* row = &without[s * numLimbs];
+                copy(&ways[s * numLimbs], &ways[(s + 1) * numLimbs], row);
+                if (s >= block) {
+                    subtractLimbs(row, numLimbs, &without[(s - block) * numLimbs], numLimbs);
+                }
+            }
+            fill(sum.begin(), sum.end(), 0);
+            for (int s = max(boundary - block + 1, 0); s <= boundary; s++) {
+                addLimbs(sum.data(), numLimbs, &without[s * numLimbs], numLimbs);
+            }
+            if (block > boundary) {
+                subtractLimbs(sum.data(), numLimbs, &one, 1);
+            }
+            perWeight[i] = BigCount(sum.data(), numLimbs);
+        }
+    };
+    if (numThreads == 1) {
+        work();
+    } else {
+        vector<thread> threads;
+        for (int i = 0; i < numThreads; i++) {
+            threads.emplace_back(work);
+        }
+        for (thread& t : threads) {
+            t.join();
+        }
+    }
+
+    Vector<BigCount> swings;
+    for (int block : blocks) {
+        swings.add(block == 0 ? BigCount(0) : perWeight[weightIndex[block]]);
+    }
+    if (tableBytes != nullptr) {
+        *tableBytes = (ways.size() + (long long) numThreads * (boundary + 1) * numLimbs) * sizeof(uint64_t);
+    }
+    return swings;
+}
+
+/*
+ * Banzhaf power indexes in percent at full double precision, from the exact
+ * swing counts of countSwingsExact, computed on <numThreads> threads
+ */
+Vector<double> computePowerIndexesExact(const Vector<int>& blocks, int numThreads) {
+    Vector<BigCount> swings = countSwingsExact(blocks, nullptr, numThreads);
+    BigCount sum;
+    for (const BigCount& count : swings) {
+        sum += count;
+    }
+    Vector<double> indexes;
+    for (const BigCount& count : swings) {
+        indexes.add(sum == BigCount(0) ? 0 : 100 * count.fractionOf(sum));
+    }
+    return indexes;
+}
+
+
+/* * * * * * Coalitions by weight and size * * * * * */
+
+/*
+ * Shared state of the generating-function engine behind computeAllPowerIndexes.
+ *
+ * A table holds, for every coalition weight s up to cap and size k up to n,
+ * the number of coalitions of some set of blocks with that weight and size,
+ * divided by C(n, k). The scaling keeps every entry at most 1 whatever n is,
+ * and makes an entry proportional to its share of a Shapley-Shubik index, so
+ * entries too small for a double are also too small to matter. Blocks of one
+ * weight form a class, added to a table one block at a time; classes are
+ * ordered heaviest first.
+ */
+struct CoalitionSpace {
+    int n;
+    int boundary;
+    int cap;                            // largest coalition weight any index looks at
+    int stride;                         // n + 1 entries per weight
+    Vector<int> weights;                // of each class, heaviest first
+    Vector<int> counts;                 // blocks in each class
+    vector<double> ratio;               // C(n, k - 1) / C(n, k)
+    vector<double> swingWeight;         // C(n, k) / 2^(n - 1), 0 for the empty coalition
+    vector<double> memberWeight;        // C(n, k) / (k * 2^(n - 1))
+};
+
+/*
+ * Add <copies> blocks of <weight> to <table>
+ */
+static void addBlocks(const CoalitionSpace& space, vector<double>& table, int weight, int copies) {
+    for (int copy = 0; copy < copies; copy++) {
+        for (int s = space.cap; s >= weight; s--) {
+            double* to = &table[s * space.stride];
+            const double* from = &table[(s - weight) * space.stride];
+            for (int k = space.n; k >= 1; k--) {
+                to[k] += space.ratio[k] * from[k - 1];
+            }
+        }
+    }
+}
+
+/*
+ * The adjoint of addBlocks: afterwards, pairing a table with the functional
+ * <table> gives what pairing it with the old functional gave after adding the
+ * blocks, so blocks can be added from the far side of a pairing
+ */
+static void addBlocksAdjoint(const CoalitionSpace& space, vector<double>& table, int weight, int copies) {
+    for (int copy = 0; copy < copies; copy++) {
+        for (int s = 0; s + weight <= space.cap; s++) {
+            double* to = &table[s * space.stride];
+            const double* from = &table[(s + weight) * space.stride];
+            for (int k = 0; k < space.n; k++) {
+                to[k] += space.ratio[k + 1] * from[k + 1];
+            }
+        }
+    }
+}
+
+/*
+ * Add <sign> times the functional that weighs each coalition of weight in
+ * (boundary, boundary + weight of class c] by 1 / (its size), i.e. the minimal
+ * winning coalitions whose lightest block is in class c
+ */
+static void addMinimalWinning(const CoalitionSpace& space, vector<double>& functional, int c, int sign) {
+    for (int s = space.boundary + 1; s <= space.boundary + space.weights[c]; s++) {
+        for (int k = 1; k <= space.n; k++) {
+            functional[s * space.stride + k] += sign * space.memberWeight[k];
+        }
+    }
+}
+
+/*
+ * Banzhaf and Shapley-Shubik shares of one block of each class in [lo, hi),
+ * given a table of all the blocks outside those classes. Each half of the
+ * range is handled with the other half added, so every class sees a table of
+ * all blocks but its own after log(classes) levels, using only additions.
+ */
+static void swingShares(const CoalitionSpace& space, int lo, int hi, vector<double>& outside,
+                        Vector<double>& banzhaf, Vector<double>& shapleyShubik) {
+    if (hi - lo == 1) {
+        int weight = space.weights[lo];
+        addBlocks(space, outside, weight, space.counts[lo] - 1);
+        double swings = 0, pivots = 0;
+        for (int s = max(space.boundary - weight + 1, 0); s <= space.boundary; s++) {
+            const double* row = &outside[s * space.stride];
+            for (int k = 0; k < space.n; k++) {
+                swings += row[k] * space.swingWeight[k];
+                pivots += row[k] / (space.n - k);
+            }
+        }
+        banzhaf[lo] = swings;
+        shapleyShubik[lo] = pivots;
+        return;
+    }
+    int mid = (lo + hi) / 2;
+    vector<double> withUpper = outside;
+    for (int c = mid; c < hi; c++) {
+        addBlocks(space, withUpper, space.weights[c], space.counts[c]);
+    }
+    swingShares(space, lo, mid, withUpper, banzhaf, shapleyShubik);
+    for (int c = lo; c < mid; c++) {
+        addBlocks(space, outside, space.weights[c], space.counts[c]);
+    }
+    swingShares(space, mid, hi, outside, banzhaf, shapleyShubik);
+}
+
+/*
+ * Deegan-Packel shares of one block of each class in [lo, hi). <heavier> is
+ * the table of all classes before lo and <lighter> the functional of class
+ * hi - 1: the minimal winning coalitions whose lightest block is in class
+ * hi - 1 or a lighter class, with the classes between added from its side.
+ * A minimal winning coalition through a block of class c consists of that
+ * block, other blocks of classes up to c, and possibly blocks of one lighter
+ * class j, the lightest; stepping the functional from class t to t - 1 adds
+ * class t from the far side and swaps in the coalitions whose lightest block
+ * is in class t - 1.
+ */
+static void memberShares(const CoalitionSpace& space, int lo, int hi, vector<double>& heavier,
+                         vector<double>& lighter, Vector<double>& deeganPackel) {
+    if (hi - lo == 1) {
+        int weight = space.weights[lo];
+        addBlocks(space, heavier, weight, space.counts[lo] - 1);
+        double share = 0;
+        for (int s = weight; s <= space.cap; s++) {
+            const double* from = &heavier[(s - weight) * space.stride];
+            const double* to = &lighter[s * space.stride];
+            for (int k = 1; k <= space.n; k++) {
+                share += space.ratio[k] * from[k - 1] * to[k];
+            }
+        }
+        deeganPackel[lo] = share;
+        return;
+    }
+    int mid = (lo + hi) / 2;
+    vector<double> upper = heavier;
+    for (int c = lo; c < mid; c++) {
+        addBlocks(space, upper, space.weights[c], space.counts[c]);
+    }
+    vector<double> lower = lighter;
+    for (int t = hi - 1; t >= mid; t--) {
+        addBlocksAdjoint(space, lower, space.weights[t], space.counts[t]);
+        addMinimalWinning(space, lower, t, -1);
+        addMinimalWinning(space, lower, t - 1, +1);
+    }
+    memberShares(space, lo, mid, heavier, lower, deeganPackel);
+    memberShares(space, mid, hi, upper, lighter, deeganPackel);
+}
+
+/*
+ * Computes the Banzhaf, Shapley-Shubik and Deegan-Packel indexes together
+ * from counts of coalitions by weight and size. Blocks of equal weight are
+ * one class: every block of a class has the same indexes, so each class is
+ * evaluated once, whatever its number of blocks. Each index of a class is a
+ * sum over a table holding every block except one of that class; the tables
+ * are built by divide and conquer over the classes, so building them costs
+ * O(n^2 * W * log(classes)) for n blocks of total weight W, and no count is
+ * ever obtained by subtracting, which keeps the doubles accurate.
+ */
+PowerIndexes computeAllPowerIndexes(const Vector<int>& blocks) {
+    Map<int, int> classSizes;
+    long long total = 0;
+    for (int block : blocks) {
+        if (block < 0) {
+            error("Blocks must have a non-negative number of votes");
+        }
+        classSizes[block]++;
+        total += block;
+    }
+    if (total > INT32_MAX) {
+        error("Total number of votes is too large");
+    }
+
+    CoalitionSpace space;
+    space.n = blocks.size();
+    space.boundary = total / 2;
+    space.stride = space.n + 1;
+    for (int weight : classSizes.keys()) {
+        space.weights.insert(0, weight);
+        space.counts.insert(0, classSizes[weight]);
+    }
+    space.cap = space.boundary + (space.weights.isEmpty() ? 0 : space.weights[0]);
+    space.ratio.assign(space.n + 1, 0);
+    space.swingWeight.assign(space.n + 1, 0);
+    space.memberWeight.assign(space.n + 1, 0);
+    for (int k = 1; k <= space.n; k++) {
+        space.ratio[k] = (double) k / (space.n - k + 1);
+        double scaled = exp(lgamma(space.n + 1) - lgamma(k + 1) - lgamma(space.n - k + 1)
+                            - (space.n - 1) * log(2.0));
+        space.swingWeight[k] = scaled;
+        space.memberWeight[k] = scaled / k;
+    }
+
+    int numClasses = space.weights.size();
+    Vector<double> banzhaf(numClasses), shapleyShubik(numClasses), deeganPackel(numClasses);
+    if (numClasses > 0) {
+        long long entries = (long long) (space.cap + 1) * space.stride;
+        vector<double> empty(entries, 0);
+        empty[0] = 1;
+        vector<double> outside = empty;
+        swingShares(space, 0, numClasses, outside, banzhaf, shapleyShubik);
+        vector<double> lightest(entries, 0);
+        addMinimalWinning(space, lightest, numClasses - 1, +1);
+        memberShares(space, 0, numClasses, empty, lightest, deeganPackel);
+    }
+
+    double banzhafSum = 0, deeganPackelSum = 0;
+    for (int c = 0; c < numClasses; c++) {
+        banzhafSum += banzhaf[c] * space.counts[c];
+        deeganPackelSum += deeganPackel[c] * space.counts[c];
+    }
+    PowerIndexes indexes;
+    for (int block : blocks) {
+        int c = 0;
+        while (space.weights[c] != block) {
+            c++;
+        }
+        indexes.banzhaf.add(banzhafSum > 0 ? 100 * banzhaf[c] / banzhafSum : 0);
+        indexes.shapleyShubik.add(100 * shapleyShubik[c]);
+        indexes.deeganPackel.add(deeganPackelSum > 0 ? 100 * deeganPackel[c] / deeganPackelSum : 0);
+    }
+    return indexes;
+}
+
+
 /* * * * * * Test Cases * * * * * */
 
 PROVIDED_TEST("Test power index, blocks 50-49-1") {
@@ -150,3 +598,275 @@ PROVIDED_TEST("Time power index operation") {
 }
 
 
+
+STUDENT_TEST("computePowerIndexesDP matches the provided power indexes") {
+    Vector<Vector<int>> inputs = {{50, 49, 1}, {1, 1, 3, 7, 9, 9}, {55, 38, 29}, {55, 38, 16},
+        {29,29,29,29,27,27,14,13,12,12,12,12,12,10,10,10,7,7,7,7,7,4,4,4,4,4,3}};
+    Vector<Vector<int>> expected = {{60, 20, 20}, {0, 0, 0, 33, 33, 33}, {33, 33, 33}, {100, 0, 0},
+        {8, 8, 8, 8, 7, 7, 3, 3, 3, 3, 3, 3, 3, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0}};
+    for (int i = 0; i < inputs.size(); i++) {
+        EXPECT_EQUAL(computePowerIndexesDP(inputs[i]), expected[i]);
+    }
+}
+
+STUDENT_TEST("countSwings matches calculateCriticalVotes on random blocks") {
+    for (int trial = 0; trial < 200; trial++) {
+        Vector<int> blocks;
+        for (int i = randomInteger(1, 12); i > 0; i--) {
+            blocks.add(randomInteger(0, 20));
+        }
+        int total = 0;
+        for (int block : blocks) {
+            total += block;
+        }
+        Vector<uint64_t> swings = countSwings(blocks);
+        for (int i = 0; i < blocks.size(); i++) {
+            Vector<int> rest = blocks.subList(0, i) + blocks.subList(i + 1, blocks.size() - i - 1);
+            Vector<int> subset;
+            EXPECT_EQUAL(swings[i], (uint64_t) calculateCriticalVotes(rest, subset, blocks[i], total / 2, 0, 0));
+        }
+        EXPECT_EQUAL(computePowerIndexesDP(blocks), computePowerIndexes(blocks));
+    }
+    EXPECT_EQUAL(computePowerIndexesDP({}), Vector<int>());
+    EXPECT_ERROR(countSwings({3, -1}));
+}
+
+STUDENT_TEST("Time power index DP up to 512 blocks") {
+    for (int size = 2; size <= 512; size *= 2) {
+        Vector<int> blocks;
+        for (int i = 0; i < size; i++) {
+            blocks.add(randomInteger(1, 10));
+        }
+        if (size <= 16) {
+            TIME_OPERATION(blocks.size(), computePowerIndexes(blocks));
+        }
+        TIME_OPERATION(blocks.size(), countSwings(blocks));
+    }
+    for (int size : {100, 500}) {
+        Vector<int> blocks;
+        for (int i = 0; i < size; i++) {
+            blocks.add(randomInteger(1, 1000));
+        }
+        TIME_OPERATION(blocks.size(), countSwings(blocks));
+    }
+}
+
+/* Test helpers for the EU post-Nice weights and the 2012-2020 US electoral college */
+static Vector<int> euPostNice() {
+    return {29,29,29,29,27,27,14,13,12,12,12,12,12,10,10,10,7,7,7,7,7,4,4,4,4,4,3};
+}
+
+static Vector<int> electoralCollege() {
+    return {9, 3, 11, 6, 55, 9, 7, 3, 3, 29, 16, 4, 4, 20, 11, 6, 6, 8, 8, 4, 10, 11, 16, 10, 6, 10,
+            3, 5, 6, 4, 14, 5, 29, 15, 3, 18, 7, 7, 20, 4, 9, 3, 11, 38, 6, 3, 13, 12, 5, 10, 3};
+}
+
+STUDENT_TEST("computePowerIndexesDP past 64 blocks gives exact equal shares") {
+    EXPECT_EQUAL(computePowerIndexesDP(Vector<int>(100, 1)), Vector<int>(100, 1));
+    EXPECT_EQUAL(computePowerIndexesDP(Vector<int>(100, 7)), Vector<int>(100, 1));
+    Vector<int> fifty(50, 2);
+    EXPECT_EQUAL(computePowerIndexesDP(fifty + fifty), Vector<int>(100, 1));
+}
+
+STUDENT_TEST("countSwingsExact agrees with 64-bit counts and with binomials") {
+    for (const Vector<int>& blocks : {euPostNice(), electoralCollege(), Vector<int>{50, 49, 1}}) {
+        Vector<uint64_t> expected = countSwings(blocks);
+        Vector<BigCount> exact = countSwingsExact(blocks);
+        for (int i = 0; i < blocks.size(); i++) {
+            EXPECT_EQUAL(exact[i], BigCount(expected[i]));
+        }
+    }
+
+    // with 101 blocks of one vote, a swing is 50 of the other 100 blocks
+    Vector<BigCount> ones = countSwingsExact(Vector<int>(101, 1));
+    EXPECT_EQUAL(ones[0].toString(), "100891344545564193334812497256");
+
+    // past 64 blocks the 64-bit counts still equal the exact ones modulo 2^64
+    Vector<int> blocks;
+    for (int i = 0; i < 300; i++) {
+        blocks.add(randomInteger(1, 30));
+    }
+    Vector<uint64_t> wrapped = countSwings(blocks);
+    Vector<BigCount> exact = countSwingsExact(blocks);
+    for (int i = 0; i < blocks.size(); i++) {
+        EXPECT_EQUAL(exact[i].low(), wrapped[i]);
+    }
+}
+
+STUDENT_TEST("computePowerIndexesExact on the EU, the electoral college and 200 equal blocks") {
+    Vector<int> euBlocks = euPostNice();
+    Vector<double> eu = computePowerIndexesExact(euBlocks);
+    Vector<int> truncated;
+    double sum = 0;
+    for (double index : eu) {
+        truncated.add(static_cast<int>(index));
+        sum += index;
+    }
+    EXPECT_EQUAL(truncated, computePowerIndexes(euBlocks));
+    EXPECT(fabs(sum - 100) < 1e-9);
+
+    Vector<double> college = computePowerIndexesExact(electoralCollege());
+    cout << "electoral college: CA " << college[4] << "%, TX " << college[43]
+         << "%, WY " << college[50] << "%" << endl;
+    EXPECT(college[4] > college[43] && college[43] > college[50]);
+
+    for (double index : computePowerIndexesExact(Vector<int>(200, 3))) {
+        EXPECT(fabs(index - 0.5) < 1e-12);
+    }
+    EXPECT_EQUAL(computePowerIndexesDP(Vector<int>(200, 3)), Vector<int>(200, 0));
+}
+
+STUDENT_TEST("Time exact power indexes, with DP table memory") {
+    Vector<Vector<int>> inputs = {euPostNice(), electoralCollege()};
+    for (int size : {100, 200, 500, 1000}) {
+        Vector<int> blocks;
+        for (int i = 0; i < size; i++) {
+            blocks.add(randomInteger(1, 100));
+        }
+        inputs.add(blocks);
+    }
+    for (const Vector<int>& blocks : inputs) {
+        long long bytes = 0;
+        countSwingsExact(blocks, &bytes);
+        cout << blocks.size() << " blocks: DP tables " << bytes << " bytes" << endl;
+        TIME_OPERATION(blocks.size(), countSwings(blocks));
+        TIME_OPERATION(blocks.size(), countSwingsExact(blocks));
+    }
+}
+
+/* Test helper: all three indexes by enumerating every coalition */
+static PowerIndexes allPowerIndexesBruteForce(const Vector<int>& blocks) {
+    int n = blocks.size();
+    int total = 0;
+    for (int block : blocks) {
+        total += block;
+    }
+    int boundary = total / 2;
+    Vector<double> swings(n), pivots(n), shares(n);
+    for (int subset = 0; subset < (1 << n); subset++) {
+        int weight = 0, size = 0, lightest = INT32_MAX;
+        for (int i = 0; i < n; i++) {
+            if (subset & (1 << i)) {
+                weight += blocks[i];
+                size++;
+                lightest = min(lightest, blocks[i]);
+            }
+        }
+        for (int i = 0; i < n; i++) {
+            if (!(subset & (1 << i)) && weight <= boundary && weight + blocks[i] > boundary) {
+                swings[i] += size > 0 ? 1 : 0;
+                pivots[i] += exp(lgamma(size + 1) + lgamma(n - size) - lgamma(n + 1));
+            }
+            if ((subset & (1 << i)) && weight > boundary && weight - lightest <= boundary) {
+                shares[i] += 1.0 / size;
+            }
+        }
+    }
+    double swingSum = 0, shareSum = 0;
+    for (int i = 0; i < n; i++) {
+        swingSum += swings[i];
+        shareSum += shares[i];
+    }
+    PowerIndexes indexes;
+    for (int i = 0; i < n; i++) {
+        indexes.banzhaf.add(swingSum > 0 ? 100 * swings[i] / swingSum : 0);
+        indexes.shapleyShubik.add(100 * pivots[i]);
+        indexes.deeganPackel.add(shareSum > 0 ? 100 * shares[i] / shareSum : 0);
+    }
+    return indexes;
+}
+
+/* Test helper: whether two index vectors agree to within <tolerance> percent */
+static bool closeTo(const Vector<double>& actual, const Vector<double>& expected, double tolerance) {
+    if (actual.size() != expected.size()) {
+        return false;
+    }
+    for (int i = 0; i < actual.size(); i++) {
+        if (fabs(actual[i] - expected[i]) > tolerance) {
+            return false;
+        }
+    }
+    return true;
+}
+
+STUDENT_TEST("computeAllPowerIndexes matches enumerating every coalition") {
+    Vector<Vector<int>> inputs = {{50, 49, 1}, {1, 1, 3, 7, 9, 9}, {55, 38, 39}, {4, 0, 4, 2}, {5}, {0, 0}};
+    for (int trial = 0; trial < 40; trial++) {
+        Vector<int> blocks;
+        int size = randomInteger(1, 12);
+        for (int i = 0; i < size; i++) {
+            blocks.add(randomInteger(0, 12));
+        }
+        inputs.add(blocks);
+    }
+    for (const Vector<int>& blocks : inputs) {
+        PowerIndexes actual = computeAllPowerIndexes(blocks);
+        PowerIndexes expected = allPowerIndexesBruteForce(blocks);
+        EXPECT(closeTo(actual.banzhaf, expected.banzhaf, 1e-9));
+        EXPECT(closeTo(actual.shapleyShubik, expected.shapleyShubik, 1e-9));
+        EXPECT(closeTo(actual.deeganPackel, expected.deeganPackel, 1e-9));
+    }
+}
+
+STUDENT_TEST("computeAllPowerIndexes on the EU and the electoral college") {
+    for (const Vector<int>& blocks : {euPostNice(), electoralCollege()}) {
+        PowerIndexes indexes = computeAllPowerIndexes(blocks);
+        EXPECT(closeTo(indexes.banzhaf, computePowerIndexesExact(blocks), 1e-9));
+        double shapleyShubikSum = 0, deeganPackelSum = 0;
+        for (int i = 0; i < blocks.size(); i++) {
+            shapleyShubikSum += indexes.shapleyShubik[i];
+            deeganPackelSum += indexes.deeganPackel[i];
+        }
+        EXPECT(fabs(shapleyShubikSum - 100) < 1e-9);
+        EXPECT(fabs(deeganPackelSum - 100) < 1e-9);
+    }
+    PowerIndexes college = computeAllPowerIndexes(electoralCollege());
+    cout << "electoral college CA: Banzhaf " << college.banzhaf[4] << "%, Shapley-Shubik "
+         << college.shapleyShubik[4] << "%, Deegan-Packel " << college.deeganPackel[4] << "%" << endl;
+
+    // with 1001 equal blocks every index is the same for every block
+    PowerIndexes equal = computeAllPowerIndexes(Vector<int>(1001, 2));
+    EXPECT(closeTo(equal.banzhaf, Vector<double>(1001, 100.0 / 1001), 1e-9));
+    EXPECT(closeTo(equal.shapleyShubik, Vector<double>(1001, 100.0 / 1001), 1e-9));
+    EXPECT(closeTo(equal.deeganPackel, Vector<double>(1001, 100.0 / 1001), 1e-9));
+}
+
+STUDENT_TEST("Time all power indexes from one coalition DP, 100 to 1000 blocks") {
+    for (int size : {100, 250, 500, 1000}) {
+        Vector<int> blocks;
+        for (int i = 0; i < size; i++) {
+            blocks.add(randomInteger(1, 5));
+        }
+        TIME_OPERATION(size, computeAllPowerIndexes(blocks));
+    }
+}
+
+STUDENT_TEST("countSwingsExact gives the same counts on any number of threads") {
+    Vector<int> synthetic;
+    for (int i = 0; i < 300; i++) {
+        synthetic.add(randomInteger(0, 60));
+    }
+    for (const Vector<int>& blocks : {euPostNice(), electoralCollege(), synthetic, Vector<int>{7}}) {
+        Vector<BigCount> serial = countSwingsExact(blocks);
+        for (int threads : {2, 3, 8, 100}) {
+            EXPECT_EQUAL(countSwingsExact(blocks, nullptr, threads), serial);
+            EXPECT_EQUAL(computePowerIndexesExact(blocks, threads), computePowerIndexesExact(blocks));
+        }
+    }
+}
+
+STUDENT_TEST("Time exact power indexes from 1 to N threads") {
+    Vector<int> synthetic;
+    for (int i = 0; i < 1000; i++) {
+        synthetic.add(randomInteger(1, 100));
+    }
+    int maxThreads = max(4, (int) thread::hardware_concurrency());
+    for (const Vector<int>& blocks : {euPostNice(), synthetic}) {
+        for (int threads = 1; threads <= maxThreads; threads *= 2) {
+            auto start = chrono::steady_clock::now();
+            computePowerIndexesExact(blocks, threads);
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            cout << blocks.size() << " blocks, " << threads << " threads: " << seconds << "s" << endl;
+        }
+    }
+}
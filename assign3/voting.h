@@ -1,6 +1,28 @@
 #pragma once
+#include <cstdint>
+#include "bigcount.h"
 #include "vector.h"
 
 Vector<int> computePowerIndexes(Vector<int>& blocks);
 Vector<int> convertToPercentages(const Vector<int>& vector);
 int calculateCriticalVotes(Vector<int>& rest, Vector<int>& subset, int target, int boundary, int index, int currentSum);
+
+Vector<uint64_t> countSwings(const Vector<int>& blocks);
+Vector<int> computePowerIndexesDP(const Vector<int>& blocks);
+
+Vector<BigCount> countSwingsExact(const Vector<int>& blocks, long long* tableBytes = nullptr,
+                                  int numThreads = 1);
+Vector<double> computePowerIndexesExact(const Vector<int>& blocks, int numThreads = 1);
+
+/*
+ * Three power indexes of every block, in percent: Banzhaf (swings), Shapley-
+ * Shubik (pivots over all orders of the blocks) and Deegan-Packel (shares of
+ * the minimal winning coalitions, split equally among their members)
+ */
+struct PowerIndexes {
+    Vector<double> banzhaf;
+    Vector<double> shapleyShubik;
+    Vector<double> deeganPackel;
+};
+
+PowerIndexes computeAllPowerIndexes(const Vector<int>& blocks);